@@ -301,8 +301,17 @@
 #define PLL1CFG_Val           0x00000023
 #define CCLKCFG_Val           0x00000003
 #define USBCLKCFG_Val         0x00000000
-#define PCLKSEL0_Val          0x00000000
-#define PCLKSEL1_Val          0x00000000
+/* UART0-UART3 run from CCLK (01 in bits 6~7 and 8~9 of PCLKSEL0, 16~17 and 18~19 of
+   PCLKSEL1) so the baud rate search in uart.c reaches the multi-Mbaud rates. The
+   LPC176x errata say PCLKSELx should only be written before PLL0 is connected, so
+   the UART clocks are chosen here for SystemInit to set, override both values on
+   the command line to pick other peripheral clocks. */
+#ifndef PCLKSEL0_Val
+#define PCLKSEL0_Val          0x00000140
+#endif
+#ifndef PCLKSEL1_Val
+#define PCLKSEL1_Val          0x00050000
+#endif
 #define PCONP_Val             0x042887DE
 #define CLKOUTCFG_Val         0x00000000
 
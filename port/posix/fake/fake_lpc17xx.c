@@ -0,0 +1,178 @@
+/*----------------------------------------------------------------------------
+ * Name: fake_lpc17xx.c
+ * Purpose: Fake UART and GPDMA register blocks for the host tests, with a GPDMA that moves bytes when a test asks it to
+ *----------------------------------------------------------------------------
+*/
+
+//The drivers program the fakes exactly as they program the board, then a test plays the hardware with fakeDMARun and fakeDMAError:
+//	a channel moves one byte per transfer, following its linked list and setting the terminal count and error status like the GPDMA
+//	the data register of a fake UART is its transmit output when written and its receive input when read
+//	write-to-clear registers take effect before each run and after the interrupt handler returns
+
+#include <stdint.h>
+
+//Include header file for the fake lpc17xx, uart_dma, and _kernelCore
+#include "lpc17xx.h"
+#include "uart_dma.h"
+#include "_kernelCore.h"
+
+//Channel control and config fields the fake acts on
+#define FAKE_CONTROL_SIZE 0xFFF
+#define FAKE_CONTROL_SI (1U << 26)
+#define FAKE_CONTROL_DI (1U << 27)
+#define FAKE_CONTROL_I (1U << 31)
+#define FAKE_CONFIG_E (1U << 0)
+#define FAKE_CONFIG_IE (1U << 14)
+#define FAKE_CONFIG_ITC (1U << 15)
+
+LPC_UART_TypeDef fakeUARTs[FAKE_UARTS];
+LPC_GPDMA_TypeDef fakeGPDMA;
+LPC_GPDMACH_TypeDef fakeGPDMAChannels[FAKE_DMA_CHANNELS];
+LPC_SC_TypeDef fakeSC;
+uint32_t fakeNVICEnabled = 0;
+
+uint8_t fakeUARTOutput[FAKE_UARTS][0x4000]; //Bytes each UART has sent
+uint32_t fakeUARTOutputLength[FAKE_UARTS]; //Number of bytes in fakeUARTOutput
+const uint8_t* fakeUARTInput[FAKE_UARTS]; //Next byte each UART will receive
+uint32_t fakeUARTInputLength[FAKE_UARTS]; //Number of bytes left to receive
+
+//Returns the UART whose data register is at a bus address, -1 for memory
+int fakeUARTAt(uint32_t address)
+{
+	for (int i = 0; i < FAKE_UARTS; i++)
+	{
+		if (address == (uint32_t)(uintptr_t)&fakeUARTs[i].RBR)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Apply the write-to-clear registers
+void fakeDMAClear(void)
+{
+	fakeGPDMA.DMACIntTCStat &= ~fakeGPDMA.DMACIntTCClear;
+	fakeGPDMA.DMACRawIntTCStat &= ~fakeGPDMA.DMACIntTCClear;
+	fakeGPDMA.DMACIntErrStat &= ~fakeGPDMA.DMACIntErrClr;
+	fakeGPDMA.DMACRawIntErrStat &= ~fakeGPDMA.DMACIntErrClr;
+	fakeGPDMA.DMACIntTCClear = 0;
+	fakeGPDMA.DMACIntErrClr = 0;
+}
+
+//Run the DMA interrupt handler like the NVIC would, masked and with the exception number set
+void fakeDMAInterrupt(void)
+{
+	uint32_t state = portEnterCritical();
+	sig_atomic_t exception = portException;
+
+	portException = 16 + DMA_IRQn;
+	DMA_IRQHandler();
+	portException = exception;
+	fakeDMAClear();
+
+	portExitCritical(state);
+}
+
+//Run the GPDMA for up to count transfers on a channel
+uint32_t fakeDMARun(int channel, uint32_t count)
+{
+	LPC_GPDMACH_TypeDef* dmaChannel = &fakeGPDMAChannels[channel];
+	uint32_t moved = 0;
+	bool interrupt = false;
+
+	fakeDMAClear();
+
+	while (moved < count && (dmaChannel->DMACCConfig & FAKE_CONFIG_E) && (dmaChannel->DMACCControl & FAKE_CONTROL_SIZE) != 0)
+	{
+		int sourceUART = fakeUARTAt(dmaChannel->DMACCSrcAddr);
+		int destinationUART = fakeUARTAt(dmaChannel->DMACCDestAddr);
+		uint8_t data;
+
+		//A UART with nothing received makes no request
+		if (sourceUART >= 0)
+		{
+			if (fakeUARTInputLength[sourceUART] == 0)
+			{
+				break;
+			}
+			data = *fakeUARTInput[sourceUART]++;
+			fakeUARTInputLength[sourceUART]--;
+		}
+		else
+		{
+			data = *(uint8_t*)(uintptr_t)dmaChannel->DMACCSrcAddr;
+		}
+
+		if (destinationUART >= 0)
+		{
+			if (fakeUARTOutputLength[destinationUART] < sizeof(fakeUARTOutput[0]))
+			{
+				fakeUARTOutput[destinationUART][fakeUARTOutputLength[destinationUART]++] = data;
+			}
+		}
+		else
+		{
+			*(uint8_t*)(uintptr_t)dmaChannel->DMACCDestAddr = data;
+		}
+
+		if (dmaChannel->DMACCControl & FAKE_CONTROL_SI)
+		{
+			dmaChannel->DMACCSrcAddr++;
+		}
+		if (dmaChannel->DMACCControl & FAKE_CONTROL_DI)
+		{
+			dmaChannel->DMACCDestAddr++;
+		}
+		dmaChannel->DMACCControl--; //The transfer size counts down in the low bits
+		moved++;
+
+		//The descriptor is done, raise its terminal count and load the next one or stop
+		if ((dmaChannel->DMACCControl & FAKE_CONTROL_SIZE) == 0)
+		{
+			if (dmaChannel->DMACCControl & FAKE_CONTROL_I)
+			{
+				fakeGPDMA.DMACRawIntTCStat |= 1U << channel;
+				if (dmaChannel->DMACCConfig & FAKE_CONFIG_ITC)
+				{
+					fakeGPDMA.DMACIntTCStat |= 1U << channel;
+					interrupt = true;
+				}
+			}
+
+			if (dmaChannel->DMACCLLI == 0)
+			{
+				dmaChannel->DMACCConfig &= ~FAKE_CONFIG_E;
+			}
+			else
+			{
+				uartDMALLI* next = (uartDMALLI*)(uintptr_t)dmaChannel->DMACCLLI;
+				dmaChannel->DMACCSrcAddr = next->source;
+				dmaChannel->DMACCDestAddr = next->destination;
+				dmaChannel->DMACCLLI = next->next;
+				dmaChannel->DMACCControl = next->control;
+			}
+		}
+	}
+
+	if (interrupt)
+	{
+		fakeDMAInterrupt();
+	}
+	return moved;
+}
+
+//Stop a channel with a bus error and raise the DMA interrupt
+void fakeDMAError(int channel)
+{
+	LPC_GPDMACH_TypeDef* dmaChannel = &fakeGPDMAChannels[channel];
+
+	fakeDMAClear();
+	dmaChannel->DMACCConfig &= ~FAKE_CONFIG_E;
+	fakeGPDMA.DMACRawIntErrStat |= 1U << channel;
+	if (dmaChannel->DMACCConfig & FAKE_CONFIG_IE)
+	{
+		fakeGPDMA.DMACIntErrStat |= 1U << channel;
+		fakeDMAInterrupt();
+	}
+}
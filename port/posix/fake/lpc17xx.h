@@ -0,0 +1,149 @@
+/*----------------------------------------------------------------------------
+ * Name: lpc17xx.h
+ * Purpose: Fake LPC17xx device header for the host tests, the UART and GPDMA register blocks are plain memory (see fake_lpc17xx.c)
+ *----------------------------------------------------------------------------
+*/
+
+//The drivers include "lpc17xx.h", so putting this directory first on the include path swaps the board for the fakes
+//The test programs are linked without PIE so every fake register and buffer sits below 4GB, the drivers store bus addresses in 32 bits
+//The register blocks keep the board's layout, a test reads and writes them through the same field names the drivers use
+
+//Include guards for the fake lpc17xx
+#ifndef _fake_lpc17xx
+#define _fake_lpc17xx
+
+#include <stdint.h>
+
+//Include header file for port, the kernel's host port provides the critical sections and the exception number
+#include "port.h"
+
+//Registers the hardware changes are read-only on the board, the fakes have to be able to write them
+#define __I volatile
+#define __O volatile
+#define __IO volatile
+
+//Interrupt numbers the drivers pass to the NVIC
+typedef enum
+{
+	UART0_IRQn = 5,
+	UART1_IRQn = 6,
+	UART2_IRQn = 7,
+	UART3_IRQn = 8,
+	DMA_IRQn = 26
+} IRQn_Type;
+
+//UART register block
+typedef struct
+{
+	union
+	{
+		__I uint8_t RBR;
+		__O uint8_t THR;
+		__IO uint8_t DLL;
+		uint32_t RESERVED0;
+	};
+	union
+	{
+		__IO uint8_t DLM;
+		__IO uint32_t IER;
+	};
+	union
+	{
+		__I uint32_t IIR;
+		__O uint8_t FCR;
+	};
+	__IO uint8_t LCR;
+	uint8_t RESERVED1[7];
+	__I uint8_t LSR;
+	uint8_t RESERVED2[7];
+	__IO uint8_t SCR;
+	uint8_t RESERVED3[3];
+	__IO uint32_t ACR;
+	__IO uint8_t ICR;
+	uint8_t RESERVED4[3];
+	__IO uint8_t FDR;
+	uint8_t RESERVED5[7];
+	__IO uint8_t TER;
+	uint8_t RESERVED6[39];
+	__I uint8_t FIFOLVL;
+} LPC_UART_TypeDef;
+
+//GPDMA controller register block
+typedef struct
+{
+	__I uint32_t DMACIntStat;
+	__I uint32_t DMACIntTCStat;
+	__O uint32_t DMACIntTCClear;
+	__I uint32_t DMACIntErrStat;
+	__O uint32_t DMACIntErrClr;
+	__I uint32_t DMACRawIntTCStat;
+	__I uint32_t DMACRawIntErrStat;
+	__I uint32_t DMACEnbldChns;
+	__IO uint32_t DMACSoftBReq;
+	__IO uint32_t DMACSoftSReq;
+	__IO uint32_t DMACSoftLBReq;
+	__IO uint32_t DMACSoftLSReq;
+	__IO uint32_t DMACConfig;
+	__IO uint32_t DMACSync;
+} LPC_GPDMA_TypeDef;
+
+//GPDMA channel register block
+typedef struct
+{
+	__IO uint32_t DMACCSrcAddr;
+	__IO uint32_t DMACCDestAddr;
+	__IO uint32_t DMACCLLI;
+	__IO uint32_t DMACCControl;
+	__IO uint32_t DMACCConfig;
+} LPC_GPDMACH_TypeDef;
+
+//System control, only the registers the drivers touch
+typedef struct
+{
+	__IO uint32_t PCONP;
+	__IO uint32_t PCLKSEL0;
+	__IO uint32_t PCLKSEL1;
+} LPC_SC_TypeDef;
+
+//Define the number of fake UARTs and GPDMA channels
+#define FAKE_UARTS 4
+#define FAKE_DMA_CHANNELS 8
+
+//Fake register blocks, in fake_lpc17xx.c
+extern LPC_UART_TypeDef fakeUARTs[FAKE_UARTS];
+extern LPC_GPDMA_TypeDef fakeGPDMA;
+extern LPC_GPDMACH_TypeDef fakeGPDMAChannels[FAKE_DMA_CHANNELS];
+extern LPC_SC_TypeDef fakeSC;
+extern uint32_t fakeNVICEnabled; //Bit per interrupt number enabled with NVIC_EnableIRQ
+
+#define LPC_SC (&fakeSC)
+#define LPC_GPDMA (&fakeGPDMA)
+#define LPC_GPDMACH0 (&fakeGPDMAChannels[0])
+
+//Point the GPDMA UART driver at the fakes through its register hooks (see uart_dma.h)
+#define UART_DMA_UART(portNum) (&fakeUARTs[portNum])
+#define UART_DMA_CHANNEL(channel) (&fakeGPDMAChannels[channel])
+#define UART_DMA_CONTROLLER (&fakeGPDMA)
+
+//The NVIC only records which interrupts are enabled, the tests call the handlers themselves
+#define NVIC_EnableIRQ(irq) (fakeNVICEnabled |= 1U << (irq))
+#define NVIC_DisableIRQ(irq) (fakeNVICEnabled &= ~(1U << (irq)))
+
+//Exception number from the host port, 0 in a thread
+#define __get_IPSR() portActiveException()
+
+//Run the GPDMA for up to count transfers on a channel, like the peripheral asking for them one at a time
+//A transmit writes into the UART's captured output and a receive reads from its pending input
+//Raises the DMA interrupt if a descriptor with the I bit finished, returns the number of transfers made
+uint32_t fakeDMARun(int channel, uint32_t count);
+
+//Stop a channel with a bus error and raise the DMA interrupt
+void fakeDMAError(int channel);
+
+//Bytes the fake UARTs have sent and have waiting to be received
+extern uint8_t fakeUARTOutput[FAKE_UARTS][0x4000];
+extern uint32_t fakeUARTOutputLength[FAKE_UARTS];
+extern const uint8_t* fakeUARTInput[FAKE_UARTS];
+extern uint32_t fakeUARTInputLength[FAKE_UARTS];
+
+#endif
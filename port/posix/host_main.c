@@ -0,0 +1,136 @@
+/*----------------------------------------------------------------------------
+ * Name: host_main.c
+ * Purpose: Host test program, runs worker threads that share a mutex and checks that it is never held twice
+ *----------------------------------------------------------------------------
+*/
+
+//Usage: rtos_host [workers] [milliseconds]
+//The workers count up a shared counter under a mutex, sleeping and yielding now and then so every path through the scheduler is used
+//A monitor thread stops the run, prints the per-thread counts, CPU load, and wake up latency, and exits with 1 if the mutex was ever held by two threads
+//Built with OS_TRACE it also writes the scheduler trace to trace.bin
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//Include header file for _threadsCore, _kernelCore, _mutexAPI, _cpuAPI, _traceAPI, and _latencyAPI
+#include "_threadsCore.h"
+#include "_kernelCore.h"
+#include "_mutexAPI.h"
+#include "_cpuAPI.h"
+#include "_traceAPI.h"
+#include "_latencyAPI.h"
+
+int mutex; //Mutex shared by the workers
+int numWorkers = 4; //Number of worker threads
+int runTime = 1000; //Length of the run in ticks (ms)
+
+volatile int holders = 0; //Number of threads inside the mutex, must never be more than 1
+volatile int violations = 0; //Number of times two threads were inside the mutex at once
+volatile uint32_t shared = 0; //Counter the workers share
+volatile uint32_t counts[MAX_THREADS]; //Number of times each worker got the mutex
+
+//Worker thread
+void worker(void* args)
+{
+	int self = osGetRunningThread();
+	uint32_t loops = 0;
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		//Block until the mutex is handed over if another thread has it
+		if (!osAcquireMutex(self, mutex))
+		{
+			osYield(); //Yield
+		}
+
+		if (++holders != 1)
+		{
+			violations++;
+		}
+		shared++;
+		counts[self]++;
+		holders--;
+
+		osReleaseMutex(self, mutex);
+
+		//Sleep or yield now and then
+		loops++;
+		if (loops % 100000 == 0)
+		{
+			osSleep(1 + self % 3);
+		}
+		else if (loops % 7 == 0)
+		{
+			osYield(); //Yield
+		}
+	}
+}
+
+//Monitor thread, ends the run
+void monitor(void* args)
+{
+	osSleep(runTime);
+
+	//Stop the workers from changing the counters while they are read
+	uint32_t state = osEnterCritical();
+	uint32_t total = 0;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		total += counts[i];
+	}
+	osExitCritical(state);
+
+	for (int i = 0; i < numWorkers; i++)
+	{
+		printf("worker %d: %u acquisitions, %u.%u%% CPU\n", i, counts[i], osGetThreadLoad(i) / 10, osGetThreadLoad(i) % 10);
+	}
+	printf("shared %u, total %u, violations %d, system load %u.%u%%\n", shared, total, violations, osGetSystemLoad() / 10, osGetSystemLoad() % 10);
+	osLatencyPrint(); //Latencies are in nanoseconds on the host
+
+#ifdef OS_TRACE
+	osTraceDump(0); //Writes trace.bin for tools/trace_to_chrome.py
+#endif
+
+	exit(violations != 0 || shared != total);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+	{
+		numWorkers = atoi(argv[1]);
+	}
+	if (argc > 2)
+	{
+		runTime = atoi(argv[2]);
+	}
+
+	//Leave room for the monitor and the idle thread
+	if (numWorkers < 1 || numWorkers > MAX_THREADS - 2)
+	{
+		fprintf(stderr, "workers must be between 1 and %d (build with a larger MAX_THREADS for more)\n", MAX_THREADS - 2);
+		return 2;
+	}
+
+	SystemInit();
+	kernelInit();
+
+	//Setup threads, the workers come first so their indexes match counts
+	for (int i = 0; i < numWorkers; i++)
+	{
+		create_thread(worker);
+	}
+	create_thread(monitor);
+
+	//Setup the mutex
+	mutex = osCreateMutex();
+
+	//printf allocates its buffer on first use, do it now since threads must not malloc
+	printf("%d workers for %d ms\n", numWorkers, runTime);
+	fflush(stdout);
+
+	//Start the kernel
+	kernel_start();
+	return 1;
+}
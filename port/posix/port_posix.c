@@ -0,0 +1,283 @@
+/*----------------------------------------------------------------------------
+ * Name: port_posix.c
+ * Purpose: Host port layer, runs the kernel as a Linux process with ucontext threads and a timer signal as the tick
+ *----------------------------------------------------------------------------
+*/
+
+//Every kernel thread is a ucontext on one Linux thread, so the kernel code runs exactly as it does on the board:
+//	the SIGALRM handler is the SysTick interrupt, it calls SysTick_Handler and switches if the timeslice ran out
+//	osYield calls osSched and switches directly, the host version of SVC followed by PendSV
+//	critical sections set a flag the signal handler checks, a tick that arrives in one runs when it ends like a pending interrupt
+//A signal can switch threads while libc holds a lock, so threads should stay away from malloc and keep printf under a mutex
+//Built with PORT_VIRTUAL_TIME there is no signal, the clock is simulated and the ticks run when portAdvance or portIdle move it past them (see port/sim)
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+
+//Include header file for _kernelCore and port
+#include "_kernelCore.h"
+#include "port.h"
+
+//Exception number of SVC, reported while osSched runs for a yield
+#define PORT_SVC_EXCEPTION 11
+
+uint32_t SystemCoreClock = 1000000000; //Cycle counts are in nanoseconds
+
+volatile sig_atomic_t portMasked = 0; //Whether the tick is masked
+volatile sig_atomic_t portTickPending = 0; //Whether a tick arrived while it was masked
+volatile sig_atomic_t portSwitchPending = 0; //Whether a switch has been asked for
+volatile sig_atomic_t portException = 0; //Number of the exception being emulated
+volatile sig_atomic_t portExclusive = 0; //Exclusive monitor for __LDREXW and __STREXW
+uint32_t portStackArea[MAX_STACK_SIZE / sizeof(uint32_t)] __attribute__((aligned(8))); //Area create_thread carves from
+
+ucontext_t portContexts[MAX_THREADS]; //Registers of each thread while it is switched out
+ucontext_t portMainContext; //Registers of main, saved by the first switch and never resumed
+int portCurrent = EMPTY_INDEX; //Thread whose context is running (EMPTY_INDEX before the first switch)
+#ifdef PORT_VIRTUAL_TIME
+uint64_t portVirtualTime = 0; //Nanoseconds of simulated time since the kernel started
+#else
+struct timespec portStartTime; //Time portInit was called, portCycles counts from here
+#endif
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int runningThread; //Current running thread index
+
+//Report a fault the board would take as a hard fault and stop
+void portFault(const char* reason)
+{
+	fprintf(stderr, "port fault: %s (thread %d)\n", reason, runningThread);
+	abort();
+}
+
+//Nothing to set up on the host
+void SystemInit(void)
+{
+}
+
+#ifdef PORT_VIRTUAL_TIME
+
+//Nanoseconds of simulated time
+uint32_t portCycles(void)
+{
+	return (uint32_t)portVirtualTime;
+}
+
+#else
+
+//Nanoseconds since the port started
+uint32_t portCycles(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((now.tv_sec - portStartTime.tv_sec) * 1000000000ULL + now.tv_nsec - portStartTime.tv_nsec);
+}
+
+#endif
+
+//Each thread keeps its registers in its ucontext, so the saved stack pointer does not change
+uint32_t* portSavedStack(uint32_t PSP_Offset)
+{
+	return osThreads[runningThread].threadStack;
+}
+
+//Switch to the thread the scheduler picked if a switch is pending, the host version of the PendSV handler
+//Called with the tick masked, returns once this thread is switched back in
+void portSwitch(void)
+{
+	if (!portSwitchPending)
+	{
+		return;
+	}
+	portSwitchPending = 0;
+
+	int previous = portCurrent;
+	thread_switch(); //Charge the CPU time like the PendSV handler does
+
+	if (runningThread != previous)
+	{
+		portCurrent = runningThread;
+		swapcontext(previous == EMPTY_INDEX ? &portMainContext : &portContexts[previous], &portContexts[runningThread]);
+	}
+}
+
+//Run one tick, the host version of the SysTick interrupt followed by a tail-chained PendSV
+void portTick(void)
+{
+	int savedErrno = errno; //The interrupted thread may be about to read errno
+
+	portMasked = 1;
+	portExclusive = 0; //Exception entry clears the exclusive monitor
+	portException = PORT_TICK_EXCEPTION;
+	SysTick_Handler();
+	portException = 0;
+	portSwitch();
+	portMasked = 0;
+
+	errno = savedErrno;
+}
+
+//Run a tick that arrived while the tick was masked
+void portRunPendingTick(void)
+{
+	while (portTickPending && !portMasked)
+	{
+		portTickPending = 0;
+		portTick();
+	}
+}
+
+//SIGALRM handler, the tick interrupt
+void portTickSignal(int signal)
+{
+	//A masked tick stays pending until the critical section ends
+	if (portMasked)
+	{
+		portTickPending = 1;
+		return;
+	}
+	portTick();
+}
+
+#ifdef PORT_VIRTUAL_TIME
+
+//Move the clock on by cycles of work for the running thread
+//Each tick on the way runs at its exact time, if it switches threads the rest of the work is done when this thread is switched back in
+void portAdvance(uint64_t cycles)
+{
+	uint64_t tickCycles = SystemCoreClock / 1000; //1ms tick
+
+	while (cycles > 0)
+	{
+		uint64_t nextTick = (portVirtualTime / tickCycles + 1) * tickCycles;
+		uint64_t step = (cycles < nextTick - portVirtualTime) ? cycles : nextTick - portVirtualTime;
+
+		portVirtualTime += step;
+		cycles -= step;
+
+		//A masked tick stays pending until the critical section ends
+		if (portVirtualTime == nextTick)
+		{
+			if (portMasked)
+			{
+				portTickPending = 1;
+			}
+			else
+			{
+				portTick();
+			}
+		}
+	}
+}
+
+//Move the clock on to the next tick
+void portIdle(void)
+{
+	uint64_t tickCycles = SystemCoreClock / 1000;
+	portAdvance(tickCycles - portVirtualTime % tickCycles);
+}
+
+#endif
+
+//Run the scheduler and switch threads
+void portYield(void)
+{
+	//On the board an SVC with interrupts masked or from a handler escalates to a hard fault
+	if (portMasked)
+	{
+		portFault("osYield called inside a critical section or an interrupt");
+	}
+
+	portMasked = 1;
+	portExclusive = 0;
+	portException = PORT_SVC_EXCEPTION;
+	osSched(EIGHT_BYTE_OFFSET);
+	portException = 0;
+	portSwitchPending = 1;
+	portSwitch();
+	portMasked = 0;
+
+	portRunPendingTick(); //A tick that arrived during the switch runs now
+}
+
+//First code of every thread
+void portThreadEntry(void)
+{
+	portMasked = 0; //The first switch into a thread ends the exception that made it
+	portRunPendingTick();
+
+	osThreads[runningThread].threadFunc(NULL);
+
+	//On the board a thread that returns jumps to the dummy LR value and faults
+	portFault("thread function returned");
+}
+
+//Install the tick signal handler and start the cycle counter
+void portInit(void)
+{
+#ifdef PORT_VIRTUAL_TIME
+	portVirtualTime = 0; //The simulated clock needs no signal
+#else
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = portTickSignal;
+	action.sa_flags = SA_RESTART; //System calls interrupted by the tick carry on
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &portStartTime);
+#endif
+}
+
+//Give the thread its own context that starts in portThreadEntry
+uint32_t* portInitThreadStack(int thread_index, uint32_t* stack, void (*func)(void* args))
+{
+	ucontext_t* context = &portContexts[thread_index];
+
+	getcontext(context);
+	context->uc_stack.ss_sp = malloc(PORT_POSIX_STACK_SIZE);
+	context->uc_stack.ss_size = PORT_POSIX_STACK_SIZE;
+	context->uc_link = NULL;
+	sigemptyset(&context->uc_sigmask); //Threads start with the tick signal unblocked
+	if (context->uc_stack.ss_sp == NULL)
+	{
+		portFault("out of memory for a thread stack");
+	}
+	makecontext(context, portThreadEntry, 0);
+
+	return stack; //The carved stack pointer is kept so create_thread still counts the stack space
+}
+
+//The tick starts with the first thread, so it never runs while kernel_start is still setting up
+void portStartTick(void)
+{
+}
+
+//Start the tick and switch to the first thread, does not return
+void portStartFirstThread(uint32_t* stack)
+{
+	portMasked = 1;
+
+#ifndef PORT_VIRTUAL_TIME
+	struct itimerval tick;
+
+	//1ms tick
+	tick.it_interval.tv_sec = 0;
+	tick.it_interval.tv_usec = 1000;
+	tick.it_value = tick.it_interval;
+	setitimer(ITIMER_REAL, &tick, NULL);
+#endif
+
+	//Pick the first thread like the first osYield does on the board
+	portException = PORT_SVC_EXCEPTION;
+	osSched(EIGHT_BYTE_OFFSET);
+	portException = 0;
+	portSwitchPending = 1;
+	portSwitch();
+
+	portFault("main context resumed");
+}
@@ -0,0 +1,133 @@
+/*----------------------------------------------------------------------------
+ * Name: port_posix.h
+ * Purpose: Host port layer, runs the kernel as a Linux process with ucontext threads and a timer signal as the tick
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for port_posix
+#ifndef _port_posix
+#define _port_posix
+
+#include <signal.h>
+#include <stdint.h>
+
+//Each thread gets its own stack from the heap, printf and the tick signal need far more than the 512 bytes a thread has on the board
+#ifndef PORT_POSIX_STACK_SIZE
+	#define PORT_POSIX_STACK_SIZE 0x10000
+#endif
+
+//Make the stack area create_thread carves from big enough for every thread, the host never writes to it
+#ifndef MAX_STACK_SIZE
+	#define MAX_STACK_SIZE (MSR_STACK_SIZE + MAX_THREADS * THREAD_STACK_SIZE)
+#endif
+
+//Files are written with stdio on the host, the trace dump goes to a file instead of a UART
+#define PORT_HOST_FILES
+
+//Cycle counts are in nanoseconds, so the clock is 1GHz
+extern uint32_t SystemCoreClock;
+
+extern volatile sig_atomic_t portMasked; //Whether the tick is masked, the host version of PRIMASK
+extern volatile sig_atomic_t portTickPending; //Whether a tick arrived while it was masked
+extern volatile sig_atomic_t portSwitchPending; //Whether a switch has been asked for, the host version of pending PendSV
+extern volatile sig_atomic_t portException; //Number of the exception being emulated, 0 in a thread
+extern volatile sig_atomic_t portExclusive; //Exclusive monitor used by __LDREXW and __STREXW
+extern uint32_t portStackArea[]; //Area create_thread carves its stack pointers from
+
+//Run a tick that arrived while the tick was masked
+void portRunPendingTick(void);
+
+//Mask the tick, returns the previous state so sections can nest
+static inline uint32_t portEnterCritical(void)
+{
+	uint32_t state = portMasked;
+	portMasked = 1;
+	__asm__ volatile ("" ::: "memory"); //Keep the section's loads and stores inside it
+	return state;
+}
+
+//Restore the state saved by portEnterCritical, a tick that arrived in the section runs now like a pending interrupt
+static inline void portExitCritical(uint32_t state)
+{
+	__asm__ volatile ("" ::: "memory");
+	portMasked = state;
+	if (!state && portTickPending)
+	{
+		portRunPendingTick();
+	}
+}
+
+//Number of the exception being emulated, 0 in a thread
+#define portActiveException() ((uint32_t)portException)
+
+//Nanoseconds since the port started, wraps like the DWT counter
+uint32_t portCycles(void);
+
+#ifdef PORT_VIRTUAL_TIME
+
+//Simulated time (see port/sim), the clock only moves when a thread says how much work it did or the idle thread waits for the tick
+//Nothing else takes any time, so the kernel's own code is free and a run goes as fast as the host can run the scheduler
+extern uint64_t portVirtualTime; //Nanoseconds of simulated time since the kernel started
+
+//Move the clock on by cycles of work for the running thread, the ticks that fall inside run at their exact time and may switch threads
+void portAdvance(uint64_t cycles);
+
+//Move the clock on to the next tick, the idle thread has nothing else to wait for
+void portIdle(void);
+
+#else
+
+//The idle thread spins until the tick like it does on the board
+#define portIdle() ((void)0)
+
+#endif
+
+//Run the scheduler and switch threads, the host version of the SVC and PendSV handlers
+void portYield(void);
+
+//Ask for a switch at the end of the tick
+#define portPendSwitch() (portSwitchPending = 1)
+
+//Each thread keeps its registers in its ucontext, so the stack pointers are left alone
+uint32_t* portSavedStack(uint32_t PSP_Offset);
+#define portRestoreStack(stack) ((void)(stack))
+
+//Top of the stack area create_thread carves its stack pointers from
+#define portInitialMSP() (portStackArea + MAX_STACK_SIZE / sizeof(uint32_t))
+
+//Load-exclusive and store-exclusive for the lock-free queues
+//The tick clears the monitor like exception entry does on the board, so a store after a switch fails and the queue retries
+static inline uint32_t __LDREXW(volatile uint32_t* address)
+{
+	portExclusive = 1;
+	return *address;
+}
+
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t* address)
+{
+	uint32_t state = portEnterCritical();
+	uint32_t failed = !portExclusive;
+	if (!failed)
+	{
+		*address = value;
+	}
+	portExclusive = 0;
+	portExitCritical(state);
+	return failed;
+}
+
+#define __CLREX() (portExclusive = 0)
+
+//Every thread runs on the same CPU, so a barrier only has to stop the compiler reordering
+#define __DMB() __asm__ volatile ("" ::: "memory")
+
+//Count leading zeros, 32 for 0 like the CLZ instruction
+#define __CLZ(value) ((value) ? (uint32_t)__builtin_clz(value) : 32U)
+
+//Nothing to set up on the host, kept so a main can call it like on the board
+void SystemInit(void);
+
+//Report a fault the board would take as a hard fault and stop
+void portFault(const char* reason);
+
+#endif
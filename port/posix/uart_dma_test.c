@@ -0,0 +1,235 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_dma_test.c
+ * Purpose: Host test of the GPDMA UART driver against the fake UART and GPDMA register blocks
+ *----------------------------------------------------------------------------
+*/
+
+//Usage: uart_dma_test
+//The test thread drives uart_dma.c on port 0 and checks what it programs into the fake registers (fake/lpc17xx.h)
+//A hardware thread plays the GPDMA for the sends that block, moving bytes, finishing the transfer, or stopping it with a bus error
+//Each check prints ok or FAIL, the exit code is the number of failures
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Include header file for the fake lpc17xx, uart_dma, _threadsCore, and _kernelCore
+#include "lpc17xx.h"
+#include "uart_dma.h"
+#include "_threadsCore.h"
+#include "_kernelCore.h"
+
+//Port and channels under test, the driver transmits on channel 2 * port and receives on the next one
+#define TEST_PORT 0
+#define TEST_TX_CHANNEL 0
+#define TEST_RX_CHANNEL 1
+
+//Longest a send waits for the hardware thread, so a broken driver fails the test instead of hanging it
+#define TEST_WAIT 1000
+
+//What the hardware thread does to the transmit channel
+#define HARDWARE_IDLE 0 //Nothing, so a send waiting for it times out
+#define HARDWARE_RUN 1 //Move bytes every tick until the transfer finishes
+#define HARDWARE_ERROR 2 //Stop the transfer with a bus error
+
+extern uartDMAPortRAM uartDMARAM[UART_NUM_PORTS]; //Descriptors and buffers of the driver
+extern uartDMAState uartDMAStates[UART_NUM_PORTS]; //Driver state
+
+volatile int hardwareMode = HARDWARE_IDLE; //What the hardware thread does
+int failures = 0; //Number of failed checks
+
+//Buffer in AHB SRAM, sent without a copy and long enough to need several descriptors
+uint8_t ahbBuffer[10000] UART_DMA_USER_RAM(0);
+
+//Buffer in normal RAM, sent through the staging buffer
+uint8_t ramBuffer[5000];
+
+//Buffer for received data
+uint8_t rxData[3 * UART_DMA_RX_HALF];
+
+//Print a check and count it if it failed
+void check(bool passed, const char* what)
+{
+	printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+	if (!passed)
+	{
+		failures++;
+	}
+}
+
+//Fill a buffer with a pattern that has no repeats shorter than 251 bytes
+void fill(uint8_t* buffer, uint32_t length, uint8_t seed)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		buffer[i] = (uint8_t)(seed + i % 251);
+	}
+}
+
+//Returns whether the fake UART sent exactly the given data since the output was last emptied
+bool sent(const uint8_t* data, uint32_t length)
+{
+	return fakeUARTOutputLength[TEST_PORT] == length && memcmp(fakeUARTOutput[TEST_PORT], data, length) == 0;
+}
+
+//Hardware thread, plays the GPDMA for the sends that block
+void hardware(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		if (fakeGPDMAChannels[TEST_TX_CHANNEL].DMACCConfig & 1)
+		{
+			if (hardwareMode == HARDWARE_RUN)
+			{
+				fakeDMARun(TEST_TX_CHANNEL, 512);
+			}
+			else if (hardwareMode == HARDWARE_ERROR)
+			{
+				fakeDMAError(TEST_TX_CHANNEL);
+			}
+		}
+		osSleep(1);
+	}
+}
+
+//Set up the port and check the registers the driver programmed
+void testInit(void)
+{
+	check(!UARTDMAInit(UART_NUM_PORTS), "init rejects an invalid port");
+	check(UARTDMAInit(TEST_PORT), "init port 0");
+	check((fakeGPDMA.DMACConfig & 1) && (fakeSC.PCONP & (1U << 29)) && (fakeNVICEnabled & (1U << DMA_IRQn)), "init powers and enables the GPDMA");
+	check((fakeUARTs[TEST_PORT].FCR & 0x08) && fakeUARTs[TEST_PORT].IER == IER_RLS, "init puts the UART FIFOs in DMA mode");
+
+	//The receive channel runs from the data register into the first half and loops over both halves
+	LPC_GPDMACH_TypeDef* rx = &fakeGPDMAChannels[TEST_RX_CHANNEL];
+	uartDMAPortRAM* ram = &uartDMARAM[TEST_PORT];
+	check((rx->DMACCConfig & 1) && ((rx->DMACCConfig >> 11) & 7) == 2 && ((rx->DMACCConfig >> 1) & 0x1F) == 9, "init starts the receive channel on the UART0 RX request");
+	check(rx->DMACCSrcAddr == (uint32_t)(uintptr_t)&fakeUARTs[TEST_PORT].RBR && rx->DMACCDestAddr == (uint32_t)(uintptr_t)ram->rxBuffer
+		&& ram->rxLLI[1].next == (uint32_t)(uintptr_t)&ram->rxLLI[0], "init links the ping-pong halves in a loop");
+}
+
+//Start a send from AHB SRAM without waiting, check the descriptor chain, then finish it
+void testStartAndChain(void)
+{
+	uartDMAPortRAM* ram = &uartDMARAM[TEST_PORT];
+	LPC_GPDMACH_TypeDef* tx = &fakeGPDMAChannels[TEST_TX_CHANNEL];
+
+	fill(ahbBuffer, sizeof(ahbBuffer), 1);
+	fakeUARTOutputLength[TEST_PORT] = 0;
+
+	check(!UARTDMASend(TEST_PORT, ahbBuffer, sizeof(ahbBuffer), 0), "start returns before the transfer finishes");
+	check((tx->DMACCConfig & 1) && ((tx->DMACCConfig >> 11) & 7) == 1 && ((tx->DMACCConfig >> 6) & 0x1F) == 8, "start enables the transmit channel on the UART0 TX request");
+	check(tx->DMACCSrcAddr == (uint32_t)(uintptr_t)ahbBuffer, "start sends from AHB SRAM without a copy");
+
+	//10000 bytes take three descriptors of at most UART_DMA_MAX_CHUNK, only the last one interrupts
+	bool chain = (tx->DMACCLLI == (uint32_t)(uintptr_t)&ram->txLLI[1]);
+	for (int i = 0; i < 3; i++)
+	{
+		uint32_t size = (i < 2) ? UART_DMA_MAX_CHUNK : sizeof(ahbBuffer) - 2 * UART_DMA_MAX_CHUNK;
+		uint32_t next = (i < 2) ? (uint32_t)(uintptr_t)&ram->txLLI[i + 1] : 0;
+		chain = chain && ram->txLLI[i].source == (uint32_t)(uintptr_t)(ahbBuffer + i * UART_DMA_MAX_CHUNK)
+			&& ram->txLLI[i].destination == (uint32_t)(uintptr_t)&fakeUARTs[TEST_PORT].THR
+			&& (ram->txLLI[i].control & 0xFFF) == size && ram->txLLI[i].next == next
+			&& ((ram->txLLI[i].control >> 31) != 0) == (i == 2);
+	}
+	check(chain, "chunks are chained over three descriptors with the interrupt on the last");
+
+	//Stop one byte short, the transfer is still busy
+	fakeDMARun(TEST_TX_CHANNEL, sizeof(ahbBuffer) - 1);
+	check(uartDMAStates[TEST_PORT].txBusy, "transfer is busy until its last byte");
+
+	fakeDMARun(TEST_TX_CHANNEL, 1);
+	check(!uartDMAStates[TEST_PORT].txBusy && !uartDMAStates[TEST_PORT].txError && !(tx->DMACCConfig & 1), "completion interrupt ends the transfer");
+	check(sent(ahbBuffer, sizeof(ahbBuffer)), "every byte was sent in order");
+	check(fakeGPDMA.DMACIntTCStat == 0, "completion interrupt clears its status");
+}
+
+//Send from normal RAM and block until the hardware thread finishes each staged part
+void testCompletion(void)
+{
+	fill(ramBuffer, sizeof(ramBuffer), 7);
+	fakeUARTOutputLength[TEST_PORT] = 0;
+	hardwareMode = HARDWARE_RUN;
+
+	check(UARTDMASend(TEST_PORT, ramBuffer, sizeof(ramBuffer), TEST_WAIT), "blocking send is woken when it completes");
+	check(sent(ramBuffer, sizeof(ramBuffer)), "staged parts were sent in order");
+
+	hardwareMode = HARDWARE_IDLE;
+}
+
+//A bus error ends the transfer and fails the send
+void testError(void)
+{
+	fakeUARTOutputLength[TEST_PORT] = 0;
+	hardwareMode = HARDWARE_ERROR;
+
+	check(!UARTDMASend(TEST_PORT, ramBuffer, 100, TEST_WAIT), "bus error fails the send");
+	check(uartDMAStates[TEST_PORT].txError && !uartDMAStates[TEST_PORT].txBusy, "bus error is reported and frees the channel");
+	check(fakeGPDMA.DMACIntErrStat == 0, "error interrupt clears its status");
+
+	hardwareMode = HARDWARE_IDLE;
+}
+
+//A send the hardware never finishes times out and leaves the transfer in flight
+void testTimeout(void)
+{
+	uint32_t start = osGetTickCount();
+
+	check(!UARTDMASend(TEST_PORT, ramBuffer, 100, 5), "send times out when the transfer never finishes");
+	uint32_t waited = osGetTickCount() - start;
+	check(waited >= 5 && waited <= 7, "timeout blocked for about 5 ticks");
+	check(uartDMAStates[TEST_PORT].txBusy && uartDMAStates[TEST_PORT].txWaiter == EMPTY_INDEX, "timed out transfer is still in flight");
+
+	//Let it finish so the receive test starts clean
+	fakeDMARun(TEST_TX_CHANNEL, 100);
+	check(!uartDMAStates[TEST_PORT].txBusy, "timed out transfer finishes later");
+}
+
+//Receive across the halves of the ping-pong buffer, then time out with nothing arriving
+void testReceive(void)
+{
+	uint8_t input[300];
+	fill(input, sizeof(input), 3);
+	fakeUARTInput[TEST_PORT] = input;
+	fakeUARTInputLength[TEST_PORT] = sizeof(input);
+
+	//The first half filling raises the interrupt, the rest sits in the second half
+	fakeDMARun(TEST_RX_CHANNEL, sizeof(input));
+	check(fakeGPDMAChannels[TEST_RX_CHANNEL].DMACCDestAddr == (uint32_t)(uintptr_t)&uartDMARAM[TEST_PORT].rxBuffer[sizeof(input)], "receive moved into the second half");
+	check(UARTDMARecieve(TEST_PORT, rxData, sizeof(rxData), 0) == sizeof(input) && memcmp(rxData, input, sizeof(input)) == 0, "receive copies everything written so far");
+
+	uint32_t start = osGetTickCount();
+	check(UARTDMARecieve(TEST_PORT, rxData, sizeof(rxData), 3) == 0 && osGetTickCount() - start >= 3, "receive times out with nothing arriving");
+}
+
+//Test thread
+void tests(void* args)
+{
+	testInit();
+	testStartAndChain();
+	testCompletion();
+	testError();
+	testTimeout();
+	testReceive();
+
+	printf("%d failures\n", failures);
+	exit(failures);
+}
+
+int main(void)
+{
+	SystemInit();
+	kernelInit();
+
+	create_thread(tests);
+	create_thread(hardware);
+
+	//printf allocates its buffer on first use, do it now since threads must not malloc
+	printf("uart_dma on fake registers\n");
+	fflush(stdout);
+
+	//Start the kernel
+	kernel_start();
+	return 1;
+}
@@ -0,0 +1,307 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_frame_test.c
+ * Purpose: Loopback test of the COBS and CRC-16 framing in uart_frame.c
+ *----------------------------------------------------------------------------
+*/
+
+//Usage: uart_frame_test
+//The UART functions uart_frame.c calls are replaced by a loopback wire, every byte UARTFrameSend sends is what UARTFrameRecieve reads
+//Between sending and receiving the test can damage the wire to check that bad frames are dropped and the receiver finds the next one
+//Each check prints ok or FAIL, the exit code is the number of failures
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Include header file for uart, uart_frame, and _kernelCore
+#include "uart.h"
+#include "uart_frame.h"
+#include "_kernelCore.h"
+
+//Port under test
+#define TEST_PORT 0
+
+//Define the size of the loopback wire, enough for every frame one check sends
+#define WIRE_SIZE 0x20000
+
+uint8_t wire[WIRE_SIZE]; //Bytes sent and not received yet
+uint32_t wireLength = 0; //Number of bytes on the wire
+uint32_t wireRead = 0; //Next byte the receiver reads
+
+int failures = 0; //Number of failed checks
+
+//Loopback transmit, puts the bytes on the wire
+uint32_t UARTSendTimeout(uint32_t portNum, uint8_t* BufferPtr, uint32_t Length, int timeout)
+{
+	if (wireLength + Length > WIRE_SIZE)
+	{
+		fprintf(stderr, "loopback wire is full\n");
+		exit(100);
+	}
+	memcpy(&wire[wireLength], BufferPtr, Length);
+	wireLength += Length;
+	return Length;
+}
+
+//Loopback receive, takes up to Length bytes off the wire and returns 0 like a timeout once it is empty
+uint32_t UARTRecieveTimeout(uint32_t portNum, uint8_t* BufferPtr, uint32_t Length, int timeout)
+{
+	uint32_t count = wireLength - wireRead;
+	if (count > Length)
+	{
+		count = Length;
+	}
+	memcpy(BufferPtr, &wire[wireRead], count);
+	wireRead += count;
+	return count;
+}
+
+//Spin lock helpers uart_frame.c takes from uart.c, the test has one thread so the lock only has to be taken and freed
+uint8_t Lock(volatile uint8_t* tbl)
+{
+	if (*tbl)
+	{
+		return 1;
+	}
+	*tbl = 1;
+	return 0;
+}
+
+void Free(volatile uint8_t* tbl)
+{
+	*tbl = 0;
+}
+
+//Print a check and count it if it failed
+void check(bool passed, const char* what)
+{
+	printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+	if (!passed)
+	{
+		failures++;
+	}
+}
+
+//Empty the wire
+void wireReset(void)
+{
+	wireLength = 0;
+	wireRead = 0;
+}
+
+//Remove count bytes from the wire starting at position
+void wireDrop(uint32_t position, uint32_t count)
+{
+	memmove(&wire[position], &wire[position + count], wireLength - position - count);
+	wireLength -= count;
+}
+
+//Returns the statistics of the port under test
+uartFrameStats stats(void)
+{
+	uartFrameStats current;
+	UARTFrameGetStats(TEST_PORT, &current);
+	return current;
+}
+
+//Send a frame and receive it straight back, returns whether it came back unchanged and was the only zero delimited frame on the wire
+bool roundTrip(uint8_t channel, const uint8_t* payload, uint32_t length)
+{
+	uint8_t received[FRAME_MAX_PAYLOAD];
+	uint8_t receivedChannel = 0xFF;
+
+	wireReset();
+	if (!UARTFrameSend(TEST_PORT, channel, payload, length))
+	{
+		return false;
+	}
+
+	//COBS leaves the delimiter as the only zero, and never makes a frame longer than FRAME_MAX_ENCODED
+	bool encoded = wireLength >= 2 && wireLength - 1 <= FRAME_MAX_ENCODED && memchr(wire, 0, wireLength - 1) == NULL && wire[wireLength - 1] == 0;
+
+	int result = UARTFrameRecieve(TEST_PORT, &receivedChannel, received, sizeof(received), 0);
+	return encoded && result == (int)length && receivedChannel == channel && memcmp(received, payload, length) == 0 && wireRead == wireLength;
+}
+
+//Every payload length from 0 to FRAME_MAX_PAYLOAD, with random bytes and with the patterns that end COBS runs in awkward places
+void testLengths(void)
+{
+	uint8_t payload[FRAME_MAX_PAYLOAD];
+	bool random = true;
+	bool zeros = true;
+	bool noZeros = true;
+
+	srand(1);
+	for (uint32_t length = 0; length <= FRAME_MAX_PAYLOAD; length++)
+	{
+		//Random bytes, about one in eight is a zero
+		for (uint32_t i = 0; i < length; i++)
+		{
+			payload[i] = (rand() % 8 == 0) ? 0 : (uint8_t)rand();
+		}
+		random = random && roundTrip(length % FRAME_MAX_CHANNELS, payload, length);
+
+		//Nothing but zeros, every byte is its own COBS block
+		memset(payload, 0, length);
+		zeros = zeros && roundTrip(1, payload, length);
+
+		//No zeros at all, the runs cross the 254 byte COBS limit at the longer lengths
+		memset(payload, 0xA5, length);
+		noZeros = noZeros && roundTrip(2, payload, length);
+	}
+	check(random, "payloads of 0 to 256 random bytes round trip");
+	check(zeros, "payloads of 0 to 256 zeros round trip");
+	check(noZeros, "payloads of 0 to 256 non-zero bytes round trip");
+	check(!UARTFrameSend(TEST_PORT, 0, payload, FRAME_MAX_PAYLOAD + 1), "payloads over 256 bytes are refused");
+	check(!UARTFrameSend(TEST_PORT, FRAME_MAX_CHANNELS, payload, 1), "invalid channels are refused");
+}
+
+//Zeros at the edges of the payload and right after a full 254 byte run
+void testEmbeddedZeros(void)
+{
+	uint8_t payload[FRAME_MAX_PAYLOAD];
+
+	memset(payload, 0x11, sizeof(payload));
+	payload[0] = 0;
+	payload[sizeof(payload) - 1] = 0;
+	check(roundTrip(0, payload, sizeof(payload)), "zeros at the start and end of the payload");
+
+	//The header takes 2 bytes, so a zero at 252 follows exactly 254 non-zero bytes
+	memset(payload, 0x22, sizeof(payload));
+	payload[252] = 0;
+	check(roundTrip(0, payload, sizeof(payload)), "zero straight after a full COBS run");
+
+	memset(payload, 0x33, sizeof(payload));
+	payload[100] = 0;
+	payload[101] = 0;
+	payload[102] = 0;
+	check(roundTrip(0, payload, sizeof(payload)), "run of zeros in the middle");
+}
+
+//A frame with a damaged CRC is dropped and counted, the frame after it is received
+void testCorruptCRC(void)
+{
+	uint8_t payload[40];
+	uint8_t received[FRAME_MAX_PAYLOAD];
+	uint8_t channel;
+	uartFrameStats before = stats();
+
+	memset(payload, 0x5A, sizeof(payload));
+	wireReset();
+	UARTFrameSend(TEST_PORT, 4, payload, sizeof(payload));
+
+	//The byte before the delimiter is the high CRC byte, flip bits without making it a zero
+	wire[wireLength - 2] ^= (wire[wireLength - 2] == 0x55) ? 0xAA : 0x55;
+
+	payload[0] = 0x77;
+	UARTFrameSend(TEST_PORT, 4, payload, sizeof(payload));
+
+	int length = UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0);
+	check(length == sizeof(payload) && received[0] == 0x77, "frame after a bad CRC is received");
+	check(stats().crcErrors == before.crcErrors + 1, "bad CRC is counted");
+	check(UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0) == -1, "nothing is left once the wire is empty");
+}
+
+//A dropped byte spoils one frame and the receiver resynchronises at its delimiter, a dropped delimiter spoils two
+void testDroppedByte(void)
+{
+	uint8_t payload[60];
+	uint8_t received[FRAME_MAX_PAYLOAD];
+	uint8_t channel;
+	uartFrameStats before = stats();
+
+	for (uint32_t i = 0; i < sizeof(payload); i++)
+	{
+		payload[i] = (uint8_t)i;
+	}
+
+	//Drop a byte from the middle of the first frame
+	wireReset();
+	UARTFrameSend(TEST_PORT, 5, payload, sizeof(payload));
+	wireDrop(20, 1);
+	payload[1] = 0xEE;
+	UARTFrameSend(TEST_PORT, 5, payload, sizeof(payload));
+
+	int length = UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0);
+	check(length == sizeof(payload) && received[1] == 0xEE && channel == 5, "receiver resynchronises after a dropped byte");
+	check(stats().crcErrors == before.crcErrors + 1, "frame with a dropped byte is counted as bad");
+
+	//Drop the delimiter of the first frame, it runs into the second and both are lost, the third is received
+	wireReset();
+	UARTFrameSend(TEST_PORT, 5, payload, sizeof(payload));
+	wireDrop(wireLength - 1, 1);
+	UARTFrameSend(TEST_PORT, 5, payload, sizeof(payload));
+	payload[1] = 0xDD;
+	UARTFrameSend(TEST_PORT, 5, payload, sizeof(payload));
+
+	length = UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0);
+	check(length == sizeof(payload) && received[1] == 0xDD, "receiver resynchronises after a dropped delimiter");
+	check(stats().crcErrors == before.crcErrors + 2, "merged frames are counted as one bad frame");
+}
+
+//Frames missing from a channel show up as a gap in its sequence numbers
+void testSequenceGaps(void)
+{
+	uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	uint8_t received[FRAME_MAX_PAYLOAD];
+	uint8_t channel;
+	uartFrameStats before = stats();
+
+	//Send three frames on channel 6 and take the middle one off the wire
+	wireReset();
+	UARTFrameSend(TEST_PORT, 6, payload, sizeof(payload));
+	uint32_t second = wireLength;
+	UARTFrameSend(TEST_PORT, 6, payload, sizeof(payload));
+	wireDrop(second, wireLength - second);
+	UARTFrameSend(TEST_PORT, 6, payload, sizeof(payload));
+
+	//A frame on another channel in between does not count as a gap on channel 6
+	UARTFrameSend(TEST_PORT, 7, payload, sizeof(payload));
+
+	int frames = 0;
+	while (UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0) >= 0)
+	{
+		frames++;
+	}
+	check(frames == 3, "the frames left on the wire are received");
+	check(stats().lost == before.lost + 1 && stats().crcErrors == before.crcErrors, "the missing frame is counted as lost");
+
+	//Sequence numbers wrap at 256 without counting a gap
+	before = stats();
+	bool wrapped = true;
+	for (int i = 0; i < 300; i++)
+	{
+		wrapped = wrapped && roundTrip(6, payload, sizeof(payload));
+	}
+	check(wrapped && stats().lost == before.lost, "sequence numbers wrap without a gap");
+}
+
+//A frame that does not fit the caller's buffer is dropped and counted
+void testSmallBuffer(void)
+{
+	uint8_t payload[32] = {0};
+	uint8_t received[16];
+	uint8_t channel;
+	uartFrameStats before = stats();
+
+	wireReset();
+	UARTFrameSend(TEST_PORT, 0, payload, sizeof(payload));
+	check(UARTFrameRecieve(TEST_PORT, &channel, received, sizeof(received), 0) == -1 && stats().overruns == before.overruns + 1,
+		"frame larger than the buffer is dropped and counted");
+}
+
+int main(void)
+{
+	//The kernel is not started, the framing only needs the tick count and never blocks on the loopback wire
+	kernelInit();
+
+	testLengths();
+	testEmbeddedZeros();
+	testCorruptCRC();
+	testDroppedByte();
+	testSequenceGaps();
+	testSmallBuffer();
+
+	printf("%d failures\n", failures);
+	return failures;
+}
@@ -0,0 +1,66 @@
+/*----------------------------------------------------------------------------
+ * Name: mps2_an385.h
+ * Purpose: Device header of the MPS2 AN385 board (CMSDK Cortex-M3) as QEMU models it, used instead of LPC17xx.h
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for mps2_an385
+#ifndef _mps2_an385
+#define _mps2_an385
+
+#include <stdint.h>
+
+//Define the interrupt numbers
+typedef enum
+{
+	//Cortex-M3 exceptions
+	NonMaskableInt_IRQn = -14,
+	HardFault_IRQn = -13,
+	MemoryManagement_IRQn = -12,
+	BusFault_IRQn = -11,
+	UsageFault_IRQn = -10,
+	SVCall_IRQn = -5,
+	DebugMonitor_IRQn = -4,
+	PendSV_IRQn = -2,
+	SysTick_IRQn = -1,
+
+	//CMSDK peripherals
+	UART0RX_IRQn = 0,
+	UART0TX_IRQn = 1,
+	UART1RX_IRQn = 2,
+	UART1TX_IRQn = 3,
+	UART2RX_IRQn = 4,
+	UART2TX_IRQn = 5,
+	GPIO0ALL_IRQn = 6,
+	GPIO1ALL_IRQn = 7,
+	TIMER0_IRQn = 8,
+	TIMER1_IRQn = 9,
+	DUALTIMER_IRQn = 10,
+	SPI_0_1_IRQn = 11,
+	UART_0_1_2_OVF_IRQn = 12,
+	ETHERNET_IRQn = 13,
+	I2S_IRQn = 14,
+	TSC_IRQn = 15
+} IRQn_Type;
+
+//Define the core configuration for the CMSIS core header
+#define __CM3_REV 0x0201 //Core revision r2p1
+#define __MPU_PRESENT 1 //The AN385 core has an MPU
+#define __NVIC_PRIO_BITS 3 //Number of priority bits QEMU implements for this board
+#define __Vendor_SysTickConfig 0 //Use the CMSIS SysTick_Config
+
+#include "core_cm3.h"
+
+//Semihosting gives stdio access to host files, the trace dump goes to a file instead of a UART
+#define PORT_HOST_FILES
+
+//QEMU does not model the DWT cycle counter, the port counts cycles with SysTick instead (see port_cm3.c)
+#define PORT_CYCLES_SYSTICK
+
+//Core clock, the AN385 FPGA runs the core at 25MHz
+extern uint32_t SystemCoreClock;
+
+//Set up the clock, nothing to do on this board
+void SystemInit(void);
+
+#endif
@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------------
+ * Name: qemu_main.c
+ * Purpose: p1_main workload for the QEMU board, three threads share a mutex and the run ends with an exit code
+ *----------------------------------------------------------------------------
+*/
+
+//Usage: make run
+//Threads 1 and 2 take turns on a mutex like in p1_main test case #2, thread 3 runs without it
+//Threads 1 and 3 also sleep now and then so the SysTick wake up path is used along with yields and timeslices
+//Once thread 1 has counted to ROUNDS the program exits with 1 if the mutex was ever held twice or a count was lost
+
+//This file is for printf and other IO functions
+#include "stdio.h"
+#include <stdlib.h>
+#include <inttypes.h>
+
+//Include header file for _threadsCore, _kernelCore, _mutexAPI, _cpuAPI, and _latencyAPI
+#include "_threadsCore.h"
+#include "_kernelCore.h"
+#include "_mutexAPI.h"
+#include "_cpuAPI.h"
+#include "_latencyAPI.h"
+
+//Number of times thread 1 increments x before the run ends
+#ifndef ROUNDS
+	#define ROUNDS 200
+#endif
+
+//Variables for threads to test that they are working
+volatile int x = 0;
+volatile int y = 0; //Copy of x thread 2 keeps under the mutex, must always match x
+volatile int z = 0; //Number of times thread 3 ran
+volatile int holders = 0; //Number of threads inside the mutex, must never be more than 1
+volatile int violations = 0; //Number of times two threads were inside the mutex, or y did not match x
+
+//Define created mutexes
+int mutex_1;
+
+//Define the threads
+int thread_1;
+int thread_2;
+int thread_3;
+
+//Thread 1, increments x under the mutex and ends the run
+void thread1(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		//Block until the mutex is handed over if thread 2 has it
+		if (!osAcquireMutex(thread_1, mutex_1))
+		{
+			osYield(); //Yield
+		}
+
+		if (++holders != 1)
+		{
+			violations++;
+		}
+		x++; //Increment x
+		printf("Thread 1, x is: %d\n", x);
+		holders--;
+
+		//Release the mutex after incrementing
+		osReleaseMutex(thread_1, mutex_1);
+
+		//End the run, printf is only used under the mutex so it is safe to take it once more
+		if (x >= ROUNDS)
+		{
+			if (!osAcquireMutex(thread_1, mutex_1))
+			{
+				osYield(); //Yield
+			}
+			printf("x %d, y %d, thread 3 ran %d times, violations %d, system load %" PRIu32 ".%" PRIu32 "%%\n", x, y, z, violations, osGetSystemLoad() / 10, osGetSystemLoad() % 10);
+			osLatencyPrint();
+			exit(violations != 0);
+		}
+
+		//Sleep now and then, yield otherwise
+		if (x % 10 == 0)
+		{
+			osSleep(2);
+		}
+		else
+		{
+			osYield(); //Yield
+		}
+	}
+}
+
+//Thread 2, checks x under the mutex
+void thread2(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		//Block until the mutex is handed over if thread 1 has it
+		if (!osAcquireMutex(thread_2, mutex_1))
+		{
+			osYield(); //Yield
+		}
+
+		if (++holders != 1)
+		{
+			violations++;
+		}
+
+		//Nobody else changes x while the mutex is held, so it must not move during the print
+		y = x;
+		printf("Thread 2, x mod 47 is: %d\n", y % 47);
+		if (y != x)
+		{
+			violations++;
+		}
+		holders--;
+
+		//Release the mutex
+		osReleaseMutex(thread_2, mutex_1);
+
+		osYield(); //Yield
+	}
+}
+
+//Thread 3, runs without the mutex and only uses the CPU
+void thread3(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		z++;
+
+		//Spin for part of a timeslice so SysTick switches away from it now and then
+		for (volatile int i = 0; i < 2000; i++)
+		{
+		}
+
+		if (z % 50 == 0)
+		{
+			osSleep(1);
+		}
+		else
+		{
+			osYield(); //Yield
+		}
+	}
+}
+
+int main(void)
+{
+	SystemInit();
+
+	//Print the value of the initial MSP location, this also makes printf allocate its buffer before the threads run
+	uint32_t* msp = getMSPInitialLocation();
+	printf("\nInitial MSP Location: %x\n", (unsigned)(uintptr_t)msp);
+
+	kernelInit();
+
+	//Setup threads
+	thread_1 = create_thread(thread1);
+	thread_2 = create_thread(thread2);
+	thread_3 = create_thread(thread3);
+
+	//Setup mutexes
+	mutex_1 = osCreateMutex();
+
+	//Start the kernel
+	kernel_start();
+
+	//kernel_start only returns if there are no threads
+	return 1;
+}
@@ -0,0 +1,132 @@
+/*----------------------------------------------------------------------------
+ * Name: startup_mps2.c
+ * Purpose: Vector table and reset handler of the MPS2 AN385 board for the GCC build
+ *----------------------------------------------------------------------------
+*/
+
+//Include the device header, it brings in the core definitions
+#include "mps2_an385.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+//Symbols placed by mps2_an385.ld
+extern uint32_t _estack; //Top of RAM, the initial MSP
+extern uint32_t _sidata; //Load address of .data in flash
+extern uint32_t _sdata; //Start of .data in RAM
+extern uint32_t _edata; //End of .data in RAM
+extern uint32_t _sbss; //Start of .bss
+extern uint32_t _ebss; //End of .bss
+
+//C library start up, semihosting stdio and the constructors
+extern void initialise_monitor_handles(void);
+extern void __libc_init_array(void);
+extern int main(void);
+
+void Reset_Handler(void);
+void Default_Handler(void);
+void HardFault_Handler(void);
+
+//Exception handlers, any the program does not define fall through to Default_Handler
+void NMI_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void MemManage_Handler(void) __attribute__((weak, alias("HardFault_Handler")));
+void BusFault_Handler(void) __attribute__((weak, alias("HardFault_Handler")));
+void UsageFault_Handler(void) __attribute__((weak, alias("HardFault_Handler")));
+void SVC_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void DebugMon_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void PendSV_Handler(void) __attribute__((weak, alias("Default_Handler")));
+void SysTick_Handler(void) __attribute__((weak, alias("Default_Handler")));
+
+//Interrupt handlers, numbered like IRQn_Type in mps2_an385.h
+void UART0RX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART0TX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART1RX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART1TX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART2RX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART2TX_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void GPIO0ALL_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void GPIO1ALL_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void TIMER0_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void TIMER1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void DUALTIMER_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void SPI_0_1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void UART_0_1_2_OVF_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void ETHERNET_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void I2S_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+void TSC_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
+
+//Vector table, the linker script puts it at address 0 where the core reads the initial MSP and the reset vector
+__attribute__((section(".isr_vector"), used))
+void (* const vectorTable[])(void) =
+{
+	(void (*)(void))&_estack,
+	Reset_Handler,
+	NMI_Handler,
+	HardFault_Handler,
+	MemManage_Handler,
+	BusFault_Handler,
+	UsageFault_Handler,
+	0, 0, 0, 0,
+	SVC_Handler,
+	DebugMon_Handler,
+	0,
+	PendSV_Handler,
+	SysTick_Handler,
+	UART0RX_IRQHandler,
+	UART0TX_IRQHandler,
+	UART1RX_IRQHandler,
+	UART1TX_IRQHandler,
+	UART2RX_IRQHandler,
+	UART2TX_IRQHandler,
+	GPIO0ALL_IRQHandler,
+	GPIO1ALL_IRQHandler,
+	TIMER0_IRQHandler,
+	TIMER1_IRQHandler,
+	DUALTIMER_IRQHandler,
+	SPI_0_1_IRQHandler,
+	UART_0_1_2_OVF_IRQHandler,
+	ETHERNET_IRQHandler,
+	I2S_IRQHandler,
+	TSC_IRQHandler
+};
+
+//Copy .data, clear .bss, set up the C library and run main
+void Reset_Handler(void)
+{
+	uint32_t* source = &_sidata;
+	for (uint32_t* dest = &_sdata; dest < &_edata; dest++)
+	{
+		*dest = *source++;
+	}
+	for (uint32_t* dest = &_sbss; dest < &_ebss; dest++)
+	{
+		*dest = 0;
+	}
+
+	SystemInit();
+	initialise_monitor_handles(); //Open stdin, stdout, and stderr on the host through semihosting
+	__libc_init_array();
+
+	exit(main());
+}
+
+//Write a string to the host console with the semihosting SYS_WRITE0 call, safe to use from a fault
+static void semihostingWrite(const char* text)
+{
+	register uint32_t operation __asm("r0") = 0x04;
+	register const char* argument __asm("r1") = text;
+	__asm volatile ("bkpt 0xAB" : "+r" (operation) : "r" (argument) : "memory");
+}
+
+//A fault stops the run with a failing exit code so a regression script sees it
+void HardFault_Handler(void)
+{
+	semihostingWrite("hard fault\n");
+	_exit(1);
+}
+
+//An interrupt nobody handles is a bug as well
+void Default_Handler(void)
+{
+	semihostingWrite("unexpected interrupt\n");
+	_exit(1);
+}
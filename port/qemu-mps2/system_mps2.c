@@ -0,0 +1,16 @@
+/*----------------------------------------------------------------------------
+ * Name: system_mps2.c
+ * Purpose: Clock set up of the MPS2 AN385 board
+ *----------------------------------------------------------------------------
+*/
+
+//Include the device header
+#include "mps2_an385.h"
+
+//The AN385 FPGA image runs the core from a fixed 25MHz clock
+uint32_t SystemCoreClock = 25000000;
+
+//Nothing to set up, QEMU starts the board with its clock running
+void SystemInit(void)
+{
+}
@@ -0,0 +1,560 @@
+/*----------------------------------------------------------------------------
+ * Name: sim_main.c
+ * Purpose: Scheduler simulator, runs a workload description on the real kernel with a simulated clock and reports response times
+ *----------------------------------------------------------------------------
+*/
+
+//Usage: rtos_sim workload.txt [responses.csv]
+//The kernel is the board's own code (osSched, SysTick_Handler, the mutexes), built on the host port with PORT_VIRTUAL_TIME
+//Each thread of the workload is a periodic task, a job is released every period and does its work with portAdvance instead of running code
+//The clock only moves while a job works or the idle thread waits, so a run takes as long as the scheduling decisions and no longer
+//When the run is over the monitor prints one CSV row per task with its response time distribution (release to finish) and deadline misses
+//The responses file gets every job's release and response time for plotting, the exit code is 1 if any job missed its deadline
+//
+//A workload file has one item per line, # starts a comment, times are in microseconds unless they end in ms or s:
+//	duration 10s						length of the run (whole ms, default 1s)
+//	seed 7								seed of the random execution times (default 1)
+//	mutex bus							a mutex the tasks can lock
+//	thread name period 10ms [offset 2ms] [deadline 8ms] exec DIST [lock bus DIST] [slice 2]
+//A job runs for exec, then holds the mutex for the lock time if it has one, deadline defaults to the period and slice to TIMESLICE
+//DIST is one of: fixed T, uniform MIN MAX, normal MEAN SD, exp MEAN (normal is cut off at 0)
+//Periods and offsets are whole ticks (ms) since a job is released by osSleep, which wakes on a tick
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//Include header file for _threadsCore, _kernelCore, _mutexAPI, _cpuAPI, and _latencyAPI
+#include "_threadsCore.h"
+#include "_kernelCore.h"
+#include "_mutexAPI.h"
+#include "_cpuAPI.h"
+#include "_latencyAPI.h"
+
+//Define the longest task and mutex name
+#define SIM_NAME_SIZE 16
+
+//Define the execution time distributions
+#define SIM_FIXED 0
+#define SIM_UNIFORM 1
+#define SIM_NORMAL 2
+#define SIM_EXP 3
+
+//Execution time distribution, the parameters are in nanoseconds
+typedef struct
+{
+	int kind; //One of the SIM_ distributions
+	double a; //Fixed time, minimum, or mean
+	double b; //Maximum or standard deviation
+} simDist;
+
+//Periodic task and what it did
+typedef struct
+{
+	char name[SIM_NAME_SIZE]; //Name from the workload file
+	uint32_t period; //Ticks between releases
+	uint32_t offset; //Tick of the first release
+	uint64_t deadline; //Nanoseconds after its release a job must finish by
+	simDist exec; //Time a job works for
+	int mutex; //Mutex a job locks after its work, EMPTY_INDEX for none
+	simDist hold; //Time a job holds the mutex for
+	int slice; //Timeslice in ticks
+
+	uint64_t* responses; //Response time of each finished job in nanoseconds
+	uint32_t jobs; //Number of finished jobs
+	uint32_t capacity; //Room in responses
+	uint32_t missed; //Finished jobs that took longer than the deadline
+	bool busy; //Whether a job has been released and not finished
+} simTask;
+
+simTask tasks[MAX_THREADS]; //Tasks in thread order
+int numTasks = 0; //Number of tasks
+
+char mutexNames[MAX_MUTEXES][SIM_NAME_SIZE]; //Name of each mutex
+int mutexes[MAX_MUTEXES]; //Kernel index of each mutex
+int numMutexes = 0; //Number of mutexes
+
+uint32_t duration = 1000; //Length of the run in ticks (ms)
+uint64_t seed = 1; //State of the random number generator
+const char* workloadPath; //Workload file, for the report
+const char* responsesPath = NULL; //File every job's response time is written to, NULL for none
+struct timespec wallStart; //Host time the kernel started, to report how much faster than real time the run was
+
+//Report a mistake in the workload file and stop
+void simError(int line, const char* message, const char* token)
+{
+	fprintf(stderr, "%s:%d: %s%s%s\n", workloadPath, line, message, token ? ": " : "", token ? token : "");
+	exit(2);
+}
+
+//Random number in [0, 1), xorshift64* so a seed always gives the same run on any host
+double simRandom(void)
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+	return (double)((seed * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+//Draw a time in nanoseconds from a distribution
+uint64_t simSample(const simDist* dist)
+{
+	double value = dist->a;
+
+	switch (dist->kind)
+	{
+		case SIM_UNIFORM:
+			value = dist->a + (dist->b - dist->a) * simRandom();
+			break;
+		case SIM_NORMAL:
+			//Box-Muller, 1 - random keeps the log away from 0
+			value = dist->a + dist->b * sqrt(-2.0 * log(1.0 - simRandom())) * cos(2.0 * M_PI * simRandom());
+			break;
+		case SIM_EXP:
+			value = -dist->a * log(1.0 - simRandom());
+			break;
+		default:
+			break;
+	}
+	return (value > 0) ? (uint64_t)(value + 0.5) : 0;
+}
+
+//Read a time, microseconds unless it ends in ms or s, returns it in nanoseconds
+double simParseTime(int line, const char* token)
+{
+	char* end;
+	double value = token ? strtod(token, &end) : -1;
+
+	if (token == NULL || end == token || value < 0)
+	{
+		simError(line, "expected a time", token);
+	}
+	if (strcmp(end, "s") == 0)
+	{
+		return value * 1e9;
+	}
+	if (strcmp(end, "ms") == 0)
+	{
+		return value * 1e6;
+	}
+	if (*end != '\0' && strcmp(end, "us") != 0)
+	{
+		simError(line, "unknown time unit", token);
+	}
+	return value * 1e3;
+}
+
+//Read a time that has to be a whole number of ticks, returns it in ticks
+uint32_t simParseTicks(int line, const char* token)
+{
+	double ns = simParseTime(line, token);
+	uint64_t tickNs = SystemCoreClock / 1000;
+
+	if (fmod(ns, (double)tickNs) != 0)
+	{
+		simError(line, "must be a whole number of ms", token);
+	}
+	return (uint32_t)(ns / tickNs);
+}
+
+//Read a distribution from the next tokens of the line
+void simParseDist(int line, simDist* dist)
+{
+	const char* kind = strtok(NULL, " \t\r\n");
+
+	if (kind == NULL)
+	{
+		simError(line, "expected a distribution", NULL);
+	}
+
+	dist->b = 0;
+	if (strcmp(kind, "fixed") == 0)
+	{
+		dist->kind = SIM_FIXED;
+		dist->a = simParseTime(line, strtok(NULL, " \t\r\n"));
+	}
+	else if (strcmp(kind, "uniform") == 0)
+	{
+		dist->kind = SIM_UNIFORM;
+		dist->a = simParseTime(line, strtok(NULL, " \t\r\n"));
+		dist->b = simParseTime(line, strtok(NULL, " \t\r\n"));
+		if (dist->b < dist->a)
+		{
+			simError(line, "uniform maximum is below its minimum", NULL);
+		}
+	}
+	else if (strcmp(kind, "normal") == 0)
+	{
+		dist->kind = SIM_NORMAL;
+		dist->a = simParseTime(line, strtok(NULL, " \t\r\n"));
+		dist->b = simParseTime(line, strtok(NULL, " \t\r\n"));
+	}
+	else if (strcmp(kind, "exp") == 0)
+	{
+		dist->kind = SIM_EXP;
+		dist->a = simParseTime(line, strtok(NULL, " \t\r\n"));
+	}
+	else
+	{
+		simError(line, "unknown distribution", kind);
+	}
+}
+
+//Read a thread line
+void simParseThread(int line)
+{
+	const char* name = strtok(NULL, " \t\r\n");
+	bool deadlineSet = false;
+	bool execSet = false;
+
+	//Leave room for the monitor and the idle thread
+	if (numTasks >= MAX_THREADS - 2)
+	{
+		simError(line, "too many threads, build with a larger MAX_THREADS", NULL);
+	}
+	if (name == NULL || strlen(name) >= SIM_NAME_SIZE)
+	{
+		simError(line, "expected a thread name shorter than 16 characters", name);
+	}
+
+	simTask* task = &tasks[numTasks];
+	strcpy(task->name, name);
+	task->period = 0;
+	task->offset = 0;
+	task->mutex = EMPTY_INDEX;
+	task->slice = TIMESLICE;
+
+	for (const char* key = strtok(NULL, " \t\r\n"); key != NULL; key = strtok(NULL, " \t\r\n"))
+	{
+		if (strcmp(key, "period") == 0)
+		{
+			task->period = simParseTicks(line, strtok(NULL, " \t\r\n"));
+		}
+		else if (strcmp(key, "offset") == 0)
+		{
+			task->offset = simParseTicks(line, strtok(NULL, " \t\r\n"));
+		}
+		else if (strcmp(key, "deadline") == 0)
+		{
+			task->deadline = (uint64_t)simParseTime(line, strtok(NULL, " \t\r\n"));
+			deadlineSet = true;
+		}
+		else if (strcmp(key, "exec") == 0)
+		{
+			simParseDist(line, &task->exec);
+			execSet = true;
+		}
+		else if (strcmp(key, "lock") == 0)
+		{
+			const char* mutexName = strtok(NULL, " \t\r\n");
+			for (int i = 0; i < numMutexes && mutexName != NULL; i++)
+			{
+				if (strcmp(mutexNames[i], mutexName) == 0)
+				{
+					task->mutex = i;
+				}
+			}
+			if (task->mutex == EMPTY_INDEX)
+			{
+				simError(line, "unknown mutex, declare it with a mutex line first", mutexName);
+			}
+			simParseDist(line, &task->hold);
+		}
+		else if (strcmp(key, "slice") == 0)
+		{
+			const char* ticks = strtok(NULL, " \t\r\n");
+			task->slice = ticks ? atoi(ticks) : 0;
+			if (task->slice <= 0)
+			{
+				simError(line, "expected a timeslice of at least 1 tick", ticks);
+			}
+		}
+		else
+		{
+			simError(line, "unknown thread setting", key);
+		}
+	}
+
+	if (task->period == 0 || !execSet)
+	{
+		simError(line, "a thread needs a period and an exec time", NULL);
+	}
+	if (!deadlineSet)
+	{
+		task->deadline = (uint64_t)task->period * (SystemCoreClock / 1000);
+	}
+	numTasks++;
+}
+
+//Read the workload file
+void simLoad(const char* path)
+{
+	char text[256];
+	int line = 0;
+	FILE* file = fopen(path, "r");
+
+	workloadPath = path;
+	if (file == NULL)
+	{
+		perror(path);
+		exit(2);
+	}
+
+	while (fgets(text, sizeof(text), file) != NULL)
+	{
+		line++;
+
+		//Drop the comment
+		char* comment = strchr(text, '#');
+		if (comment != NULL)
+		{
+			*comment = '\0';
+		}
+
+		const char* key = strtok(text, " \t\r\n");
+		if (key == NULL)
+		{
+			continue;
+		}
+
+		if (strcmp(key, "thread") == 0)
+		{
+			simParseThread(line);
+		}
+		else if (strcmp(key, "mutex") == 0)
+		{
+			const char* name = strtok(NULL, " \t\r\n");
+			if (numMutexes >= MAX_MUTEXES)
+			{
+				simError(line, "too many mutexes, MAX_MUTEXES is the limit", NULL);
+			}
+			if (name == NULL || strlen(name) >= SIM_NAME_SIZE)
+			{
+				simError(line, "expected a mutex name shorter than 16 characters", name);
+			}
+			strcpy(mutexNames[numMutexes++], name);
+		}
+		else if (strcmp(key, "duration") == 0)
+		{
+			duration = simParseTicks(line, strtok(NULL, " \t\r\n"));
+		}
+		else if (strcmp(key, "seed") == 0)
+		{
+			const char* value = strtok(NULL, " \t\r\n");
+			seed = value ? strtoull(value, NULL, 0) : 0;
+			if (seed == 0)
+			{
+				simError(line, "expected a seed other than 0", value);
+			}
+		}
+		else
+		{
+			simError(line, "unknown item", key);
+		}
+	}
+	fclose(file);
+
+	if (numTasks == 0 || duration == 0)
+	{
+		simError(line, "the workload needs at least one thread and a duration", NULL);
+	}
+}
+
+//Keep the response time of a finished job
+//Nothing interrupts a thread on the simulated clock except the ticks it runs itself, so threads can use malloc here
+void simRecord(simTask* task, uint64_t response)
+{
+	if (task->jobs == task->capacity)
+	{
+		task->capacity = task->capacity ? task->capacity * 2 : 1024;
+		task->responses = realloc(task->responses, task->capacity * sizeof(uint64_t));
+		if (task->responses == NULL)
+		{
+			portFault("out of memory for the response times");
+		}
+	}
+	task->responses[task->jobs++] = response;
+	if (response > task->deadline)
+	{
+		task->missed++;
+	}
+}
+
+//Periodic task thread, releases a job every period and does its work on the simulated clock
+void simThread(void* args)
+{
+	int self = osGetRunningThread();
+	simTask* task = &tasks[self];
+	uint32_t release = task->offset; //Tick the next job is released on
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		//Sleep until the release, a job that is already late starts straight away
+		uint32_t now = osGetTickCount();
+		if (release > now)
+		{
+			osSleep(release - now);
+		}
+
+		uint64_t releaseTime = (uint64_t)release * (SystemCoreClock / 1000);
+		task->busy = true;
+
+		portAdvance(simSample(&task->exec));
+
+		//Block until the mutex is handed over if another thread has it
+		if (task->mutex != EMPTY_INDEX)
+		{
+			if (!osAcquireMutex(self, mutexes[task->mutex]))
+			{
+				osYield(); //Yield
+			}
+			portAdvance(simSample(&task->hold));
+			osReleaseMutex(self, mutexes[task->mutex]);
+		}
+
+		simRecord(task, portVirtualTime - releaseTime);
+		task->busy = false;
+		release += task->period;
+	}
+}
+
+//Sort response times for the percentiles
+int simCompare(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+//Response time that permille thousandths of the jobs finished within, in microseconds
+double simPercentile(const uint64_t* sorted, uint32_t count, uint32_t permille)
+{
+	uint64_t rank = ((uint64_t)count * permille + 999) / 1000;
+	return sorted[rank ? rank - 1 : 0] / 1e3;
+}
+
+//Print the report and write the responses file
+int simReport(void)
+{
+	struct timespec wallEnd;
+	clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+	double wall = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+	double simulated = portVirtualTime / 1e9;
+	uint64_t busy = 0;
+	int failed = 0;
+
+	for (int i = 0; i < numTasks; i++)
+	{
+		busy += osGetThreadCycles(i);
+	}
+
+	printf("# %s: %d threads, %d mutexes, %.3f s simulated in %.3f s (%.0fx real time)\n",
+		workloadPath, numTasks, numMutexes, simulated, wall, wall > 0 ? simulated / wall : 0);
+	printf("# CPU load %.1f%%, %u context switches\n", 100.0 * busy / portVirtualTime, osGetSwitchCount());
+	printf("thread,period_ms,deadline_us,jobs,missed,pending,min_us,avg_us,p50_us,p90_us,p99_us,p99.9_us,max_us,cpu_pct\n");
+
+	for (int i = 0; i < numTasks; i++)
+	{
+		simTask* task = &tasks[i];
+		double cpu = 100.0 * osGetThreadCycles(i) / portVirtualTime;
+
+		if (task->missed != 0)
+		{
+			failed = 1;
+		}
+		if (task->jobs == 0)
+		{
+			printf("%s,%u,%.1f,0,0,%d,,,,,,,,%.1f\n", task->name, task->period, task->deadline / 1e3, task->busy, cpu);
+			continue;
+		}
+
+		uint64_t* sorted = malloc(task->jobs * sizeof(uint64_t));
+		uint64_t total = 0;
+		if (sorted == NULL)
+		{
+			portFault("out of memory for the report");
+		}
+		for (uint32_t j = 0; j < task->jobs; j++)
+		{
+			sorted[j] = task->responses[j];
+			total += sorted[j];
+		}
+		qsort(sorted, task->jobs, sizeof(uint64_t), simCompare);
+
+		printf("%s,%u,%.1f,%u,%u,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", task->name, task->period, task->deadline / 1e3,
+			task->jobs, task->missed, task->busy, sorted[0] / 1e3, total / 1e3 / task->jobs, simPercentile(sorted, task->jobs, 500),
+			simPercentile(sorted, task->jobs, 900), simPercentile(sorted, task->jobs, 990), simPercentile(sorted, task->jobs, 999),
+			sorted[task->jobs - 1] / 1e3, cpu);
+		free(sorted);
+	}
+
+	osLatencyPrint(); //Wake-up latencies are in simulated nanoseconds
+
+	if (responsesPath != NULL)
+	{
+		FILE* file = fopen(responsesPath, "w");
+		if (file == NULL)
+		{
+			perror(responsesPath);
+			return 2;
+		}
+		fprintf(file, "thread,job,release_us,response_us\n");
+		for (int i = 0; i < numTasks; i++)
+		{
+			for (uint32_t j = 0; j < tasks[i].jobs; j++)
+			{
+				fprintf(file, "%s,%u,%llu,%.3f\n", tasks[i].name, j,
+					(unsigned long long)(tasks[i].offset + (uint64_t)j * tasks[i].period) * 1000, tasks[i].responses[j] / 1e3);
+			}
+		}
+		fclose(file);
+	}
+	return failed;
+}
+
+//Monitor thread, ends the run
+void monitor(void* args)
+{
+	osSleep(duration);
+	exit(simReport());
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		fprintf(stderr, "usage: %s workload.txt [responses.csv]\n", argv[0]);
+		return 2;
+	}
+	if (argc > 2)
+	{
+		responsesPath = argv[2];
+	}
+	simLoad(argv[1]);
+
+	SystemInit();
+	kernelInit();
+
+	//Setup threads, the tasks come first so their indexes match tasks
+	for (int i = 0; i < numTasks; i++)
+	{
+		create_thread(simThread);
+		osSetTimeslice(i, tasks[i].slice);
+	}
+	create_thread(monitor);
+
+	//Setup the mutexes
+	for (int i = 0; i < numMutexes; i++)
+	{
+		mutexes[i] = osCreateMutex();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+	//Start the kernel
+	kernel_start();
+	return 2;
+}
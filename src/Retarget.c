@@ -16,6 +16,8 @@
 
 #include <stdio.h>
 #include <rt_misc.h>
+#include "_kernelCore.h"
+#include "_logAPI.h"
 
 #ifdef __RTGT_GLCD
 	#include "GLCD_Scroll.h"
@@ -34,6 +36,12 @@
 	#define __DBG_ITM
 #endif
 
+//Define __DBG_ITM_PORTS to give every thread its own ITM stimulus port, read them with tools/itm_demux.py
+//The debugger printf window only shows port 0, so it will then only show output from before the kernel starts
+#if defined( __DBG_ITM ) && defined( __DBG_ITM_PORTS )
+	#include "itm.h"
+#endif
+
 //#pragma import(__use_no_semihosting_swi)
 
 #ifdef __RTGT_GLCD
@@ -41,9 +49,32 @@
 volatile uint8_t glcd_init_called = 0;
 #endif
 
+#if defined( __DBG_ITM ) && defined( __DBG_ITM_PORTS )
+//A switch varaible to see if the init is called.
+//ITMInit only writes fixed values, so two threads calling it is harmless
+volatile uint8_t itm_init_called = 0;
+#endif
+
 #ifdef __RTGT_UART
 //A switch varaible to see if the init is called.
 volatile uint8_t uart_init_called = 0;
+
+/*----------------------------------------------------------------------------
+Call UARTInit once, whichever thread gets here first
+*----------------------------------------------------------------------------*/
+void uart_init( void ) {
+
+	//Check and set the flag with interrupts off so two threads cannot both initialise the UART,
+	//the flag is only set once UARTInit is done so nobody sends to a half configured port
+	if ( uart_init_called == 0 ) {
+		uint32_t state = osEnterCritical();
+		if ( uart_init_called == 0 ) {
+			UARTInit(PORT_NUM, BAUD_RATE);
+			uart_init_called = 1;
+		}
+		osExitCritical(state);
+	}
+}
 #endif
 
 /*----------------------------------------------------------------------------
@@ -61,14 +92,8 @@ int sendchar( int c ) {
 	#endif
 
 	#ifdef __RTGT_UART
-
-	//call init_scroll if it is not called
-	//Warning, this is not a thread safe code
-	if ( uart_init_called == 0 ) {
-		uart_init_called = 1;
-		UARTInit(PORT_NUM, BAUD_RATE);
-	}
-
+	//call UARTInit if it is not called
+	uart_init();
 	#endif
 	
 	if ( c == '\r' || c == '\n' ) {
@@ -93,6 +118,29 @@ int sendchar( int c ) {
 }
 
 
+/*----------------------------------------------------------------------------
+Write a block of bytes that already has CR LF line endings, used by the logger thread
+*----------------------------------------------------------------------------*/
+void sendblock( uint8_t *buffer, uint32_t length ) {
+
+	#ifdef __RTGT_UART
+		uart_init();
+		#ifndef __RTGT_GLCD
+			//The whole line goes into the transmit ring in one go
+			UARTSend(PORT_NUM, buffer, length);
+			return;
+		#endif
+	#endif
+
+	//sendchar turns the LF back into CR LF, so skip the CR
+	for ( uint32_t i = 0; i < length; i++ ) {
+		if ( buffer[i] != '\r' ) {
+			sendchar(buffer[i]);
+		}
+	}
+}
+
+
 /*----------------------------------------------------------------------------
 Read character from Serial Port   (blocking read)
 *----------------------------------------------------------------------------*/
@@ -100,12 +148,7 @@ int getkey( void ) {
 
 	#ifdef __RTGT_UART
 	//call UARTInit if it is not called
-	//Warning, this is not a thread safe code
-
-	if ( uart_init_called == 0 ) {
-		uart_init_called = 1;
-		UARTInit(PORT_NUM, BAUD_RATE);
-	}
+	uart_init();
 	#endif
 	
 	#if defined( __RTGT_UART ) || defined( __DBG_ITM )
@@ -123,6 +166,25 @@ FILE __stdin;
 
 int fputc( int ch, FILE *f ) {
 
+	#if defined( __DBG_ITM ) && defined( __DBG_ITM_PORTS )
+		//A stimulus port write costs a few cycles per word, so threads write their own port instead of using the logger
+		if ( itm_init_called == 0 ) {
+			ITMInit();
+			itm_init_called = 1;
+		}
+		if ( ch == '\r' || ch == '\n' ) {
+			ITMPutChar('\r');
+			ITMPutChar('\n');
+		} else {
+			ITMPutChar(ch);
+		}
+		return ch;
+	#endif
+
+	//Threads only copy into their line buffer, the logger thread does the slow part
+	if ( osLogPutChar(ch) ) {
+		return ch;
+	}
 	return (sendchar(ch));
 }
 
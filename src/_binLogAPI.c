@@ -0,0 +1,111 @@
+/*----------------------------------------------------------------------------
+ * Name: _binLogAPI.c
+ * Purpose: Stores any functions a part of the Binary Log API, used to log without formatting text on the target
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _threadsCore, _binLogAPI, and uart (a port with host files has none)
+#include "_kernelCore.h"
+#include "_threadsCore.h"
+#include "_binLogAPI.h"
+#ifndef PORT_HOST_FILES
+	#include "uart.h"
+#endif
+
+uint32_t binLogRing[BINLOG_RING_WORDS]; //Ring of records, each record is a whole number of words
+volatile uint32_t binLogHead = 0; //Word count written so far, only changed inside a critical section
+volatile uint32_t binLogTail = 0; //Word count sent so far, only changed by the binary log thread
+volatile uint32_t binLogDropped = 0; //Number of records dropped because the ring was full
+uint32_t binLogPort; //UART port the ring is sent to
+#ifdef PORT_HOST_FILES
+FILE* binLogFile; //The host and QEMU ports have no UART, the ring goes to binlog.bin instead
+#endif
+int binLogThread = EMPTY_INDEX; //Binary log thread index (EMPTY_INDEX until osCreateBinLog succeeds)
+
+//Create the thread that sends the ring to a UART port every BINLOG_FLUSH_PERIOD ticks, returns the thread index or -1
+int osCreateBinLog(uint32_t portNum)
+{
+	//Only one thread drains the ring
+	if (binLogThread != EMPTY_INDEX)
+	{
+		return binLogThread;
+	}
+
+	binLogPort = portNum;
+#ifdef PORT_HOST_FILES
+	//Open the file here since threads must not allocate, unbuffered so writing to it never allocates either
+	binLogFile = fopen("binlog.bin", "wb");
+	if (binLogFile == NULL)
+	{
+		return -1;
+	}
+	setvbuf(binLogFile, NULL, _IONBF, 0);
+#endif
+	binLogThread = create_thread(osBinLogThread);
+	return binLogThread;
+}
+
+//Add a record to the ring, the whole record is written inside one short critical section so records from threads and ISRs never interleave
+void osBinLogWrite(uint32_t header, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3)
+{
+	uint32_t args[4] = {arg0, arg1, arg2, arg3};
+	uint32_t numArgs = header & BINLOG_ARG_MASK;
+	uint32_t state = osEnterCritical();
+	uint32_t head = binLogHead;
+
+	//Drop the record if it does not fit, the reader never sees part of one
+	if (head - binLogTail + 2 + numArgs > BINLOG_RING_WORDS)
+	{
+		binLogDropped++;
+		osExitCritical(state);
+		return;
+	}
+
+	binLogRing[head++ & (BINLOG_RING_WORDS - 1)] = header; //Format string address and argument count
+	binLogRing[head++ & (BINLOG_RING_WORDS - 1)] = portCycles(); //Timestamp in CPU cycles
+	for (uint32_t i = 0; i < numArgs; i++)
+	{
+		binLogRing[head++ & (BINLOG_RING_WORDS - 1)] = args[i];
+	}
+	binLogHead = head;
+
+	osExitCritical(state);
+}
+
+//Returns the number of records dropped because the ring was full
+uint32_t osBinLogGetDropped(void)
+{
+	return binLogDropped;
+}
+
+//Binary log thread that sends the ring contents to the UART
+void osBinLogThread(void* args)
+{
+	while (1)
+	{
+		uint32_t head = binLogHead; //Only whole records are ever published, so everything up to head can be sent
+		uint32_t tail = binLogTail;
+
+		while (tail != head)
+		{
+			//Send up to the end of the ring, the rest goes on the next pass
+			uint32_t start = tail & (BINLOG_RING_WORDS - 1);
+			uint32_t words = head - tail;
+			if (words > BINLOG_RING_WORDS - start)
+			{
+				words = BINLOG_RING_WORDS - start;
+			}
+
+#ifdef PORT_HOST_FILES
+			fwrite(&binLogRing[start], 4, words, binLogFile);
+#else
+			//UARTSend copies the words into its transmit ring, so they can be reused once it returns
+			UARTSend(binLogPort, (uint8_t*)&binLogRing[start], words * 4);
+#endif
+			tail += words;
+			binLogTail = tail;
+		}
+
+		osSleep(BINLOG_FLUSH_PERIOD); //Sleep until the next flush
+	}
+}
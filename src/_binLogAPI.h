@@ -0,0 +1,45 @@
+/*----------------------------------------------------------------------------
+ * Name: _binLogAPI.h
+ * Purpose: Stores any functions a part of the Binary Log API, used to log without formatting text on the target
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _binLogAPI
+#ifndef _binLogAPI
+#define _binLogAPI
+
+#include "osDefs.h"
+
+//Format strings are kept in their own section, the host decoder looks them up in the ELF file by address
+#define BINLOG_SECTION __attribute__((section(".binlog_fmt"), aligned(8)))
+
+//The format strings are 8 byte aligned, so the low 3 bits of the address carry the number of arguments
+#define BINLOG_ARG_MASK 0x7
+
+//Declare the format string of one log call, only its address is ever written to the ring
+#define BINLOG_FORMAT(fmt) static const char binLogFormat[] BINLOG_SECTION = fmt
+
+//Log a format string with up to 4 integer arguments, each record is the format address, the portCycles count, and the raw arguments
+//Arguments are sent as 32-bit words, so %s and floating point conversions cannot be decoded
+#define osBinLog0(fmt) do { BINLOG_FORMAT(fmt); osBinLogWrite((uint32_t)binLogFormat | 0, 0, 0, 0, 0); } while (0)
+#define osBinLog1(fmt, a) do { BINLOG_FORMAT(fmt); osBinLogWrite((uint32_t)binLogFormat | 1, (uint32_t)(a), 0, 0, 0); } while (0)
+#define osBinLog2(fmt, a, b) do { BINLOG_FORMAT(fmt); osBinLogWrite((uint32_t)binLogFormat | 2, (uint32_t)(a), (uint32_t)(b), 0, 0); } while (0)
+#define osBinLog3(fmt, a, b, c) do { BINLOG_FORMAT(fmt); osBinLogWrite((uint32_t)binLogFormat | 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0); } while (0)
+#define osBinLog4(fmt, a, b, c, d) do { BINLOG_FORMAT(fmt); osBinLogWrite((uint32_t)binLogFormat | 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d)); } while (0)
+
+//Create the thread that sends the ring to a UART port every BINLOG_FLUSH_PERIOD ticks, returns the thread index or -1
+//The port should be set up with UARTInit and not be shared with printf, must be called before kernel_start
+//A port with host files (POSIX, QEMU) writes the ring to binlog.bin instead and ignores portNum
+int osCreateBinLog(uint32_t portNum);
+
+//Add a record to the ring, use the osBinLog macros instead of calling this directly
+//Safe to call from any thread or ISR, the record is dropped if the ring is full
+void osBinLogWrite(uint32_t header, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+//Returns the number of records dropped because the ring was full
+uint32_t osBinLogGetDropped(void);
+
+//Binary log thread that sends the ring contents to the UART
+void osBinLogThread(void* args);
+
+#endif
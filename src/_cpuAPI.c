@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------------
+ * Name: _cpuAPI.c
+ * Purpose: Stores any functions a part of the CPU usage API, used to measure how much CPU time each thread and the ISRs use
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _cpuAPI, and _traceAPI
+#include "_kernelCore.h"
+#include "_cpuAPI.h"
+#include "_traceAPI.h"
+
+uint32_t cpuLastCycles = 0; //Cycle count at the last time cycles were charged
+int cpuAccountedThread = EMPTY_INDEX; //Thread charged for the cycles since then (EMPTY_INDEX before the first switch)
+uint32_t cpuISRDepth = 0; //Number of interrupt handlers currently running
+uint64_t cpuISRCycles = 0; //CPU cycles spent in interrupt handlers
+uint64_t cpuTotalCycles = 0; //CPU cycles charged to anything
+uint32_t cpuSlotTicks = 0; //Ticks since the last window slot was filled
+
+extern int runningThread; //Current running thread index
+
+//Snapshots of the counters taken every CPU_WINDOW_SLOT_TICKS, the load is the change between the oldest and newest snapshot
+//Entry MAX_THREADS of each snapshot holds the ISR cycles
+uint64_t cpuSnapshots[CPU_WINDOW_SLOTS][MAX_THREADS + 1];
+uint64_t cpuSnapshotTotal[CPU_WINDOW_SLOTS];
+int cpuNextSlot = 0; //Slot filled next, which is also the oldest one
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int num_threads; //Number of threads created
+
+//Charge the cycles since the last charge to whatever was running, must be called with interrupts disabled
+//Charges happen at least every tick, so the 32-bit cycle counter never wraps between two of them
+void cpuCharge(void)
+{
+	uint32_t now = portCycles();
+	uint32_t delta = now - cpuLastCycles;
+	cpuLastCycles = now;
+
+	if (cpuISRDepth > 0)
+	{
+		cpuISRCycles += delta;
+	}
+	else if (cpuAccountedThread != EMPTY_INDEX)
+	{
+		osThreads[cpuAccountedThread].runCycles += delta;
+	}
+	else
+	{
+		return; //Time before the kernel starts is not counted
+	}
+	cpuTotalCycles += delta;
+}
+
+//Start counting, called by kernel_start just before the first thread runs
+void osCpuStart(void)
+{
+	uint32_t state = osEnterCritical();
+	cpuLastCycles = portCycles();
+	osExitCritical(state);
+}
+
+//Charge the cycles since the last switch to the thread that was running and start charging the new one
+void osCpuSwitch(int thread_index)
+{
+	//The PendSV handler that calls this can be interrupted
+	uint32_t state = osEnterCritical();
+	cpuCharge();
+	cpuAccountedThread = thread_index;
+	osExitCritical(state);
+}
+
+//Call at the start of every interrupt handler
+void osISREnter(void)
+{
+	uint32_t state = osEnterCritical();
+	cpuCharge();
+	cpuISRDepth++;
+	osTrace(TRACE_ISR_ENTER, runningThread, portActiveException(), 0);
+	osExitCritical(state);
+}
+
+//Call at the end of every interrupt handler
+void osISRExit(void)
+{
+	uint32_t state = osEnterCritical();
+	cpuCharge();
+	cpuISRDepth--;
+	osTrace(TRACE_ISR_EXIT, runningThread, portActiveException(), 0);
+	osExitCritical(state);
+}
+
+//Move the usage window on, called by the SysTick handler every tick
+void osCpuTick(void)
+{
+	uint32_t state = osEnterCritical();
+
+	//Charging every tick keeps the cycle counter from wrapping between charges even if a thread runs for a long time
+	cpuCharge();
+
+	cpuSlotTicks++;
+	if (cpuSlotTicks >= CPU_WINDOW_SLOT_TICKS)
+	{
+		cpuSlotTicks = 0;
+
+		//Overwrite the oldest snapshot with the counters as they are now
+		for (int i = 0; i < num_threads; i++)
+		{
+			cpuSnapshots[cpuNextSlot][i] = osThreads[i].runCycles;
+		}
+		cpuSnapshots[cpuNextSlot][MAX_THREADS] = cpuISRCycles;
+		cpuSnapshotTotal[cpuNextSlot] = cpuTotalCycles;
+
+		cpuNextSlot++;
+		if (cpuNextSlot >= CPU_WINDOW_SLOTS)
+		{
+			cpuNextSlot = 0;
+		}
+	}
+
+	osExitCritical(state);
+}
+
+//Returns the change of one counter over the window in tenths of a percent of all cycles, entry MAX_THREADS is the ISRs
+uint32_t cpuWindowLoad(int entry)
+{
+	uint32_t state = osEnterCritical();
+
+	//The newest snapshot is the one before the next slot, and the oldest is the next slot itself
+	int newest = (cpuNextSlot == 0) ? CPU_WINDOW_SLOTS - 1 : cpuNextSlot - 1;
+	uint64_t cycles = cpuSnapshots[newest][entry] - cpuSnapshots[cpuNextSlot][entry];
+	uint64_t total = cpuSnapshotTotal[newest] - cpuSnapshotTotal[cpuNextSlot];
+
+	osExitCritical(state);
+
+	if (total == 0)
+	{
+		return 0; //The first window has not been filled yet
+	}
+	return (uint32_t)((cycles * 1000) / total);
+}
+
+//Returns the share of the CPU a thread used over the last window in tenths of a percent (0 to 1000)
+uint32_t osGetThreadLoad(int thread_index)
+{
+	if (thread_index < 0 || thread_index >= num_threads)
+	{
+		return 0;
+	}
+	return cpuWindowLoad(thread_index);
+}
+
+//Returns the share of the CPU interrupt handlers used over the last window in tenths of a percent
+uint32_t osGetISRLoad(void)
+{
+	return cpuWindowLoad(MAX_THREADS);
+}
+
+//Returns the share of the CPU not spent in the idle thread over the last window in tenths of a percent
+uint32_t osGetSystemLoad(void)
+{
+	//The idle thread is always the last thread created
+	return 1000 - osGetThreadLoad(num_threads - 1);
+}
+
+//Returns the total number of CPU cycles a thread has run for
+uint64_t osGetThreadCycles(int thread_index)
+{
+	uint32_t state = osEnterCritical();
+	uint64_t cycles = osThreads[thread_index].runCycles;
+	osExitCritical(state);
+	return cycles;
+}
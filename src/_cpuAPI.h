@@ -0,0 +1,40 @@
+/*----------------------------------------------------------------------------
+ * Name: _cpuAPI.h
+ * Purpose: Stores any functions a part of the CPU usage API, used to measure how much CPU time each thread and the ISRs use
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _cpuAPI
+#ifndef _cpuAPI
+#define _cpuAPI
+
+#include "osDefs.h"
+
+//Start counting, called by kernel_start just before the first thread runs
+void osCpuStart(void);
+
+//Charge the cycles since the last switch to the thread that was running and start charging the new one
+//Called by thread_switch
+void osCpuSwitch(int thread_index);
+
+//Call at the start and end of every interrupt handler so the time in it is not charged to the interrupted thread
+//Nested interrupts are counted once
+void osISREnter(void);
+void osISRExit(void);
+
+//Move the usage window on, called by the SysTick handler every tick
+void osCpuTick(void);
+
+//Returns the share of the CPU a thread used over the last window in tenths of a percent (0 to 1000)
+uint32_t osGetThreadLoad(int thread_index);
+
+//Returns the share of the CPU interrupt handlers used over the last window in tenths of a percent
+uint32_t osGetISRLoad(void);
+
+//Returns the share of the CPU not spent in the idle thread over the last window in tenths of a percent
+uint32_t osGetSystemLoad(void);
+
+//Returns the total number of CPU cycles a thread has run for
+uint64_t osGetThreadCycles(int thread_index);
+
+#endif
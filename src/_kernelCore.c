@@ -7,29 +7,52 @@
 //Include header file for _kernelCore and _threadsCore
 #include "_kernelCore.h" 
 #include "_threadsCore.h"
+#include "_timerAPI.h"
+#include "_cpuAPI.h"
+#include "_traceAPI.h"
+#include "_latencyAPI.h"
+#include "port.h"
 
 rtosThread osThreads[MAX_THREADS]; //Static thread struct array
 int runningThread = 0; //Current running thread index
+volatile uint32_t osTickCount = 0; //Number of SysTick interrupts (ms) since the kernel started
+volatile bool kernelRunning = false; //Whether kernel_start has handed the CPU to the threads
+volatile uint32_t osSwitchCount = 0; //Number of times the scheduler has switched to a different thread
 
 extern int num_threads; //Number of threads created
 
 //Initializes memory structures and interrupts necessary to run the kernel
 void kernelInit(void)
 {
-	//Define the priorities of the PendSV, SysTick, and SVC interrupts
-	SHPR3 |= 0xFE << 16; //Set the priority of PendSV to almost the weakest (0xFE)
-	SHPR3 |= 0xFFU << 24; //Set the priority of SysTick to be the weakest (0xFFU)
-	SHPR2 |= 0xFDU << 24; //Set the priority of SVC the be the strongest (0xFDU)
+	//Set the interrupt priorities and start the cycle counter, which the kernel uses to timestamp events
+	portInit();
 }
 
 //Called by the kernel to schedule which threads to run
 void osSched(uint32_t PSP_Offset)
 {
+	int prevThread = runningThread; //Thread being switched out, for the trace
+	uint32_t reason = TRACE_REASON_YIELD; //Why it is being switched out, for the trace
+	
 	//Check to make sure there is a thread currently running
 	if (runningThread >= 0)
 	{
-		//Sleeping threads are handled by the SysTick handler so their state should not be changed here after a context switch
-		if (osThreads[runningThread].status != SLEEPING)
+		//Work out why the thread is giving up the CPU, the SysTick handler only calls the scheduler when the timeslice runs out
+		if (osThreads[runningThread].status == SLEEPING)
+		{
+			reason = TRACE_REASON_SLEEP;
+		}
+		else if (osThreads[runningThread].status == BLOCKED)
+		{
+			reason = TRACE_REASON_BLOCK;
+		}
+		else if (portActiveException() == PORT_TICK_EXCEPTION)
+		{
+			reason = TRACE_REASON_TIMESLICE;
+		}
+		
+		//Sleeping and blocked threads are woken up by the SysTick handler or by whatever they wait on, so only a running thread is changed here
+		if (osThreads[runningThread].status == RUNNING)
 		{
 			osThreads[runningThread].status = WAITING; //Set the current thread as waiting but not running yet
 		}
@@ -37,55 +60,57 @@ void osSched(uint32_t PSP_Offset)
 		//Set the thread stack pointer to the PSP
 		//The thread stack pointer must be restored to its location after all registers are pushed
 		//This is the specified PSP_Offset number of bytes lower than its location before PendSV executes
-		osThreads[runningThread].threadStack = (uint32_t*)(__get_PSP() - PSP_Offset);
+		osThreads[runningThread].threadStack = portSavedStack(PSP_Offset);
 	}
 	
-	int previousActiveThread = runningThread; //Save the previous active thread index
-	runningThread++; //Loop through the threads 
-	
-	//Reset the runningThread back to the first thread (0) after it has looped through all of the threads
-	if (runningThread >= num_threads - 1)
-	{
-		runningThread = 0;
-	}
+	int nextThread = runningThread; //Index of the next thread to check
 	
-	//Loop through the thread struct array when the next runningThread index is a sleeping thread
-	while(osThreads[runningThread].status == SLEEPING || osThreads[runningThread].status == BLOCKED)
+	//Look at every user thread once, starting with the one after the previous active thread
+	for (int i = 0; i < num_threads - 1; i++)
 	{
-		runningThread++; //Increment the index to loop through the threads 
+		nextThread++; //Loop through the threads
 		
-		//Reset the runningThread back to the first thread (0) after it has looped through all of the threads
-		if (runningThread >= num_threads - 1)
+		//Reset back to the first thread (0) after it has looped through all of the user threads
+		if (nextThread >= num_threads - 1)
 		{
-			runningThread = 0;
+			nextThread = 0;
 		}
 		
-		//After looping through all of the threads, if they are all sleeping then run the idle thread
-		if (runningThread == previousActiveThread + 1)
+		//Run the first thread that is not sleeping or blocked
+		if (osThreads[nextThread].status != SLEEPING && osThreads[nextThread].status != BLOCKED)
 		{
-			runningThread = num_threads - 1; //Set the running thread to be the idle thread
+			runningThread = nextThread;
+			osThreads[runningThread].status = RUNNING; //Set the thread to be in the running state
+			
+			//Record the switch, a thread that keeps the CPU is not a switch
+			if (runningThread != prevThread)
+			{
+				osSwitchCount++;
+				osTrace(TRACE_SWITCH, prevThread, runningThread, reason);
+			}
+			return;
 		}
 	}
 	
+	//After looping through all of the threads, if they are all sleeping or blocked then run the idle thread
+	runningThread = num_threads - 1;
+	
 	//Set the thread to be in the running state
 	osThreads[runningThread].status = RUNNING;
+	
+	//Record the switch, a thread that keeps the CPU is not a switch
+	if (runningThread != prevThread)
+	{
+		osSwitchCount++;
+		osTrace(TRACE_SWITCH, prevThread, runningThread, reason);
+	}
 }
 
 //Call PendSV interrupt to context switch
 void osYield(void)
 {
 	//Trigger the SVC handler
-	__asm("SVC #0");
-}
-
-//Sets the value of PSP to threadStack and ensures that the microcontroller is using that value by changing the CONTROL register
-void setThreadingWithPSP(uint32_t* threadStack)
-{
-	//Set PSP to the new thread stack address
-	__set_PSP((uint32_t)threadStack); 
-	
-	//Switch to threading mode by setting the CONTROL, which involves shifting a 1 into its 1st bit
-	__set_CONTROL(1<<1);
+	portYield();
 }
 
 //Sleep function to put a thread to sleep
@@ -96,35 +121,137 @@ void osSleep(int sleepTime)
 	osYield(); //Yield
 }
 
+//Mark the running thread as blocked so the scheduler skips it until osWakeThread is called or timeout ticks pass
+//Call this inside a critical section right after checking the thread still has to wait, then exit the critical section and yield
+//A wakeup that arrives between the critical section and the yield simply makes the thread runnable again, so it is never lost
+//The yield cannot happen inside the critical section since an SVC with interrupts disabled escalates to a hard fault
+void osBlockRunningThread(int timeout)
+{
+	osThreads[runningThread].blockTimer = timeout; //Set the timeout, counted down by the SysTick handler
+	osThreads[runningThread].timedOut = false; //The block has not timed out yet
+	osThreads[runningThread].status = BLOCKED; //Block the thread until it is woken
+}
+
+//Returns whether the last block of the running thread ended because its timeout ran out
+bool osBlockTimedOut(void)
+{
+	return osThreads[runningThread].timedOut;
+}
+
+//Wake a blocked thread so the scheduler can run it again, can be called from threads and ISRs
+void osWakeThread(int thread_index)
+{
+	//Only blocked threads are woken, a thread that is already runnable is left alone
+	if (osThreads[thread_index].status == BLOCKED)
+	{
+		osThreads[thread_index].blockTimer = WAIT_FOREVER; //Stop the timeout
+		osThreads[thread_index].status = WAITING; //Move the thread back into the OS's thread waiting pool
+		osTrace(TRACE_WAKE, thread_index, TRACE_WAKE_SIGNAL, 0);
+		osLatencyReady(thread_index); //Start timing how long it waits to run
+	}
+}
+
+//Disable interrupts for a short critical section, returns the previous interrupt state so sections can nest
+uint32_t osEnterCritical(void)
+{
+	return portEnterCritical();
+}
+
+//Restore the interrupt state saved by osEnterCritical
+void osExitCritical(uint32_t state)
+{
+	portExitCritical(state); //Re-enable interrupts only if they were enabled before
+}
+
 //Start the kernel
 bool kernel_start(void)
 {
 	create_thread(osIdleThread); //Create the idle thread
 	
-	SysTick_Config(SystemCoreClock/1000); //Configure the SysTick timer
+	portStartTick(); //Start the 1ms tick
 	
 	//Check if any threads have been created
 	if (num_threads > 0)
 	{
 		//Initialization for the first thread before it starts running
 		runningThread = -1; //No threads currently running, the thread at index 0 will run first when running the scheduler 
-		setThreadingWithPSP(osThreads[0].threadStack); //Set thread mode and SP to PSP by calling setThreadingWithPSP function
-		osYield(); //Yield
+		kernelRunning = true; //From here on threads can block
+		osCpuStart(); //Start measuring CPU usage from the first thread
+		osTraceStart(); //Start recording scheduler events (does nothing unless OS_TRACE is defined)
+		portStartFirstThread(osThreads[0].threadStack); //Switch to thread mode and run the first thread
 	}
 	return 0; //Return false when no threads have been created, or an error occurred
 }
 
+//Returns the number of ticks (ms) since the kernel started
+uint32_t osGetTickCount(void)
+{
+	return osTickCount;
+}
+
+//Returns the number of times the scheduler has switched to a different thread
+uint32_t osGetSwitchCount(void)
+{
+	return osSwitchCount;
+}
+
+//Change how many ticks a thread runs for before the scheduler moves on, returns false if the thread or timeslice is not valid
+//The new timeslice starts the next time the thread's timer is reset, so a timeslice in progress is not cut short
+bool osSetTimeslice(int thread_index, int ticks)
+{
+	if (thread_index < 0 || thread_index >= num_threads || ticks < 1)
+	{
+		return false;
+	}
+	osThreads[thread_index].timeslice = ticks;
+	return true;
+}
+
+//Returns the timeslice of a thread in ticks
+int osGetTimeslice(int thread_index)
+{
+	return osThreads[thread_index].timeslice;
+}
+
+//Returns the index of the running thread
+int osGetRunningThread(void)
+{
+	return runningThread;
+}
+
+//Returns whether the caller is a thread that is allowed to block (the kernel is running and it is not an ISR)
+bool osCanBlock(void)
+{
+	return kernelRunning && portActiveException() == 0;
+}
+
 //Switch between threads
 int thread_switch(void)
 {
+	//Charge the CPU time since the last switch to the thread being switched out
+	osCpuSwitch(runningThread);
+	
+	//The thread being switched in starts running now, so a wake up latency ends here
+	osLatencyRun(runningThread);
+	
 	//Set the new PSP for the context switch
-	__set_PSP((uint32_t)osThreads[runningThread].threadStack);
+	portRestoreStack(osThreads[runningThread].threadStack);
 	return 1; //Return value can be used in assembly in r0
 }
 
 //SysTick handler function to handle timers
 void SysTick_Handler(void)
 {
+	osISREnter(); //Time in the handler is not charged to the running thread
+	
+	osTickCount++; //Count the tick
+	
+	//Move the CPU usage window on
+	osCpuTick();
+	
+	//Wake the timer service thread if a software timer has expired
+	osTimerTick();
+	
 	//Decrement the timer for all sleeping threads
 	for (int i = 0; i < num_threads - 1; i++)
 	{
@@ -137,7 +264,24 @@ void SysTick_Handler(void)
 			if (osThreads[i].timer == 0)
 			{
 				osThreads[i].status = WAITING; //Set status from sleeping to waiting
-				osThreads[i].timer = TIMESLICE; //Reset the timer to the default timeslice
+				osThreads[i].timer = osThreads[i].timeslice; //Reset the timer to the thread's timeslice
+				osTrace(TRACE_WAKE, i, TRACE_WAKE_SLEEP, 0);
+				osLatencyReady(i);
+			}
+		}
+		//Decrement the timeout for blocked threads that have one
+		else if (osThreads[i].status == BLOCKED && osThreads[i].blockTimer > 0)
+		{
+			osThreads[i].blockTimer--; //Decrement timeout
+			
+			//Check that the timeout is up for blocked threads
+			if (osThreads[i].blockTimer == 0)
+			{
+				osThreads[i].blockTimer = WAIT_FOREVER; //Stop the timeout
+				osThreads[i].timedOut = true; //Let the thread know it was not woken by what it waited on
+				osThreads[i].status = WAITING; //Set status from blocked to waiting
+				osTrace(TRACE_WAKE, i, TRACE_WAKE_TIMEOUT, 0);
+				osLatencyReady(i);
 			}
 		}
 	}
@@ -147,7 +291,7 @@ void SysTick_Handler(void)
 	//Check that the timer is up for running threads
 	if (osThreads[runningThread].timer == 0)
 	{
-		osThreads[runningThread].timer = TIMESLICE; //Reset the timeslice for the thread
+		osThreads[runningThread].timer = osThreads[runningThread].timeslice; //Reset the timeslice for the thread
 		
 		//Call the scheduler function
 		//Offset by only 8x4 bytes when using SysTick to keep the stack aligned
@@ -155,48 +299,43 @@ void SysTick_Handler(void)
 		osSched(EIGHT_BYTE_OFFSET);
 		
 		//Yield manually so that we don't have to pass the offset into osYield()
-		//Set PendSV exception state to pending to run the interrupt when all other interrupts are done
-		//Bit 28 of this register controls the behaviour of PendSV 
-		ICSR |= 1<<28;
-		
-		//Clear the pipeline before triggering an interrupt
-		__asm("isb");
+		//The switch happens when all other interrupts are done
+		portPendSwitch();
 	}
-}
-
-//SVC handler function
-void SVC_Handler_Main(uint32_t *svc_args)
-{
-	//Get the argument from the stack
-	char call = ((char*)svc_args[6])[-2];
 	
-	//Yield Switch
-	if(call == YIELD_SWITCH)
-	{	
-		//Run the scheduler
-		osSched(EIGHT_BYTE_OFFSET);
-		
-		//Set PendSV exception state to pending to run the interrupt when all other interrupts are done
-		//Bit 28 of this register controls the behaviour of PendSV 
-		ICSR |= 1<<28;
-		
-		//Clear the pipeline before triggering an interrupt
-		__asm("isb");
-	}
+	osISRExit();
 }
 
 //Idle thread when no other thread is running
 //This thread could call the scheduler after running 
 //However, for this lab it was chosen to run for the complete time slice of 5ms before context switching
+//Built with OS_QUIET_IDLE it does not print, the simulator (port/sim) runs through thousands of idle timeslices a second
 void osIdleThread(void* args)
 {
+#ifndef OS_QUIET_IDLE
+	bool printed = false; //Whether the message has been printed in this timeslice
+#endif
+	
 	//Infinite loop for the thread
 	while (1)
 	{
-		//Only print the first time the idle thread loops
-		if (osThreads[runningThread].timer == TIMESLICE)
+#ifndef OS_QUIET_IDLE
+		//Only print the first time the idle thread loops in a timeslice
+		if (osThreads[runningThread].timer == osThreads[runningThread].timeslice)
 		{
-			printf("Running idle thread\n");
+			if (!printed)
+			{
+				printf("Running idle thread\n");
+				printed = true;
+			}
 		}
+		else
+		{
+			printed = false;
+		}
+#endif
+		
+		//Let the port wait for the tick, the simulator moves its clock on here
+		portIdle();
 	}
 }
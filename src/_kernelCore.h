@@ -22,12 +22,43 @@ void osYield(void);
 //Sleep function to put a thread to sleep
 void osSleep(int sleepTime);
 
-//Sets the value of PSP to threadStack and ensures that the microcontroller is using that value by changing the CONTROL register
-void setThreadingWithPSP(uint32_t* threadStack);
+//Mark the running thread as blocked so the scheduler skips it until osWakeThread is called or timeout ticks pass
+//Call inside a critical section, then exit the critical section and call osYield
+void osBlockRunningThread(int timeout);
+
+//Returns whether the last block of the running thread ended because its timeout ran out
+bool osBlockTimedOut(void);
+
+//Wake a blocked thread so the scheduler can run it again, can be called from threads and ISRs
+void osWakeThread(int thread_index);
+
+//Disable interrupts for a short critical section, returns the previous interrupt state so sections can nest
+uint32_t osEnterCritical(void);
+
+//Restore the interrupt state saved by osEnterCritical
+void osExitCritical(uint32_t state);
 
 //Start the kernel, returns false if no threads have been created
 bool kernel_start(void);
 
+//Returns the number of ticks (ms) since the kernel started
+uint32_t osGetTickCount(void);
+
+//Returns the number of times the scheduler has switched to a different thread
+uint32_t osGetSwitchCount(void);
+
+//Change how many ticks a thread runs for before the scheduler moves on, returns false if the thread or timeslice is not valid
+bool osSetTimeslice(int thread_index, int ticks);
+
+//Returns the timeslice of a thread in ticks
+int osGetTimeslice(int thread_index);
+
+//Returns the index of the running thread
+int osGetRunningThread(void);
+
+//Returns whether the caller is a thread that is allowed to block (the kernel is running and it is not an ISR)
+bool osCanBlock(void);
+
 //Helper function to switch threads and switch the PSP instead of using assembly
 int thread_switch(void);
 
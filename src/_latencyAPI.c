@@ -0,0 +1,133 @@
+/*----------------------------------------------------------------------------
+ * Name: _latencyAPI.c
+ * Purpose: Stores any functions a part of the Latency API, used to measure how long each thread waits to run after it is woken
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore and _latencyAPI
+#include "_kernelCore.h"
+#include "_latencyAPI.h"
+
+//This file is for the printf formats of the fixed width integers (PRIu32)
+#include "inttypes.h"
+
+osLatencyStats latencyStats[MAX_THREADS]; //Histogram of each thread
+uint32_t latencyReadyCycles[MAX_THREADS]; //Cycle count when each thread was last woken
+bool latencyPending[MAX_THREADS]; //Whether each thread has been woken and not run since
+
+extern int num_threads; //Number of threads created
+
+//Timestamp a thread becoming ready to run
+void osLatencyReady(int thread_index)
+{
+	uint32_t state = osEnterCritical();
+
+	//The latency runs from the first wake up, a second one before the thread runs does not restart it
+	if (!latencyPending[thread_index])
+	{
+		latencyReadyCycles[thread_index] = portCycles();
+		latencyPending[thread_index] = true;
+	}
+
+	osExitCritical(state);
+}
+
+//Record the latency of a thread that was woken and is now starting to run
+void osLatencyRun(int thread_index)
+{
+	uint32_t state = osEnterCritical();
+
+	//Threads switched in after a yield or a timeslice were never woken, so only pending ones are measured
+	if (latencyPending[thread_index])
+	{
+		uint32_t latency = portCycles() - latencyReadyCycles[thread_index];
+		osLatencyStats* stats = &latencyStats[thread_index];
+		latencyPending[thread_index] = false;
+
+		//Bucket i holds latencies below 2^i cycles, which is the number of bits the latency needs
+		uint32_t bucket = 32 - __CLZ(latency);
+		if (bucket >= LATENCY_BUCKETS)
+		{
+			bucket = LATENCY_BUCKETS - 1; //The last bucket counts everything longer
+		}
+
+		stats->buckets[bucket]++;
+		stats->count++;
+		stats->total += latency;
+		if (latency > stats->max)
+		{
+			stats->max = latency;
+		}
+	}
+
+	osExitCritical(state);
+}
+
+//Copy the histogram of a thread into stats
+bool osGetLatencyStats(int thread_index, osLatencyStats* stats)
+{
+	if (thread_index < 0 || thread_index >= num_threads)
+	{
+		return false;
+	}
+
+	//Copy in one critical section so the counts all come from the same moment
+	uint32_t state = osEnterCritical();
+	*stats = latencyStats[thread_index];
+	osExitCritical(state);
+	return true;
+}
+
+//Returns the latency in cycles that permille thousandths of the wake ups stayed under
+uint32_t osLatencyPercentile(const osLatencyStats* stats, uint32_t permille)
+{
+	//Number of wake ups that have to be counted before the percentile is reached, rounded up
+	uint64_t needed = ((uint64_t)stats->count * permille + 999) / 1000;
+	uint64_t counted = 0;
+
+	for (uint32_t i = 0; i < LATENCY_BUCKETS - 1; i++)
+	{
+		counted += stats->buckets[i];
+		if (counted >= needed)
+		{
+			//Top of bucket i, the max is tighter when the bucket holds the longest latency
+			uint32_t top = (i == 0) ? 0 : (1U << i) - 1;
+			return (top < stats->max) ? top : stats->max;
+		}
+	}
+	return stats->max; //The percentile is in the last bucket, which has no top
+}
+
+//Clear the histograms of every thread
+void osLatencyReset(void)
+{
+	uint32_t state = osEnterCritical();
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		latencyStats[i] = (osLatencyStats){0};
+	}
+	osExitCritical(state);
+}
+
+//Print the histograms of every thread as CSV
+void osLatencyPrint(void)
+{
+	osLatencyStats stats;
+
+	printf("# wake up latency in cycles, clock %" PRIu32 " Hz, bucket i counts latencies below 2^i cycles\n", SystemCoreClock);
+	printf("thread,wakes,avg,p50,p99,max,buckets\n");
+
+	//The idle thread is never woken, so it is left out
+	for (int i = 0; i < num_threads - 1; i++)
+	{
+		//Copy each thread first so the critical section does not last for the printf
+		osGetLatencyStats(i, &stats);
+
+		printf("%d,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",", i, stats.count, stats.count ? (uint32_t)(stats.total / stats.count) : 0,
+			osLatencyPercentile(&stats, 500), osLatencyPercentile(&stats, 990), stats.max);
+		for (int j = 0; j < LATENCY_BUCKETS; j++)
+		{
+			printf(j < LATENCY_BUCKETS - 1 ? "%" PRIu32 " " : "%" PRIu32 "\n", stats.buckets[j]);
+		}
+	}
+}
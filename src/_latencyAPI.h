@@ -0,0 +1,33 @@
+/*----------------------------------------------------------------------------
+ * Name: _latencyAPI.h
+ * Purpose: Stores any functions a part of the Latency API, used to measure how long each thread waits to run after it is woken
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _latencyAPI
+#ifndef _latencyAPI
+#define _latencyAPI
+
+#include "osDefs.h"
+
+//Timestamp a thread becoming ready to run, called where threads are woken
+//(sleep and timeout expiry in the SysTick handler, mutex handoff in osReleaseMutex, and osWakeThread from threads and ISRs)
+void osLatencyReady(int thread_index);
+
+//Record the latency of a thread that was woken and is now starting to run, called by thread_switch
+void osLatencyRun(int thread_index);
+
+//Copy the histogram of a thread into stats, returns false if the thread does not exist
+bool osGetLatencyStats(int thread_index, osLatencyStats* stats);
+
+//Returns the latency in cycles that permille thousandths of the wake ups stayed under (990 for p99)
+//The histogram only knows which bucket it falls in, so this is the top of that bucket, never more than the max
+uint32_t osLatencyPercentile(const osLatencyStats* stats, uint32_t permille);
+
+//Clear the histograms of every thread
+void osLatencyReset(void);
+
+//Print the histograms of every thread as CSV, call from a thread since printf can take a while
+void osLatencyPrint(void);
+
+#endif
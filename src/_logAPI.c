@@ -0,0 +1,159 @@
+/*----------------------------------------------------------------------------
+ * Name: _logAPI.c
+ * Purpose: Stores any functions a part of the Log API, used to move printf output off the calling thread
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for stdio, _kernelCore, _threadsCore, _queueAPI, _waitSetAPI, and _logAPI
+#include <stdio.h>
+#include <inttypes.h>
+#include "_kernelCore.h"
+#include "_threadsCore.h"
+#include "_queueAPI.h"
+#include "_waitSetAPI.h"
+#include "_logAPI.h"
+
+char logBuffers[LOG_NUM_LINES][LOG_LINE_SIZE]; //Line buffers shared by every thread that prints
+int logFreeQueue; //Lock-free queue of line buffers nobody is using
+int logReadyQueue; //Lock-free queue of finished lines, each item is the buffer index plus the length shifted up 8 bits
+int logWaitSet; //Wait set the logger blocks on until a line is ready
+int loggerThread = EMPTY_INDEX; //Logger thread index (EMPTY_INDEX until osCreateLogger succeeds)
+volatile uint32_t logDropped = 0; //Number of lines cut short because no buffer was free
+
+//Line being built by each thread, only the owning thread touches its entries
+int logLines[MAX_THREADS]; //Buffer index held by the thread (EMPTY_INDEX if none)
+uint32_t logLengths[MAX_THREADS]; //Number of bytes in the held buffer
+bool logDropping[MAX_THREADS]; //Whether the rest of the current line is being dropped
+
+//Writes a block of bytes straight to the device, defined by the retarget layer
+extern void sendblock(uint8_t* buffer, uint32_t length);
+
+//Create the logger thread and its line buffers, returns the logger thread index or -1 if it cannot be created
+int osCreateLogger(void)
+{
+	//Only one logger is needed
+	if (loggerThread != EMPTY_INDEX)
+	{
+		return loggerThread;
+	}
+
+	logFreeQueue = osCreateQueue();
+	logReadyQueue = osCreateQueue();
+	logWaitSet = osCreateWaitSet();
+	if (logFreeQueue == -1 || logReadyQueue == -1 || logWaitSet == -1 || osWaitSetAddQueue(logWaitSet, logReadyQueue) == -1)
+	{
+		return -1; //Return -1 if there are not enough queues or wait sets left
+	}
+
+	//Every line buffer starts out free
+	for (uint32_t i = 0; i < LOG_NUM_LINES; i++)
+	{
+		osQueuePut(logFreeQueue, i);
+	}
+
+	//No thread holds a line yet
+	for (int i = 0; i < MAX_THREADS; i++)
+	{
+		logLines[i] = EMPTY_INDEX;
+		logLengths[i] = 0;
+		logDropping[i] = false;
+	}
+
+	//The logger is only used once its thread exists
+	loggerThread = create_thread(osLoggerThread);
+	return loggerThread;
+}
+
+//Add a character of printf output to the line buffer of the running thread
+bool osLogPutChar(int ch)
+{
+	//Write straight to the device before the kernel starts and from ISRs, they have no line of their own
+	if (loggerThread == EMPTY_INDEX || !osCanBlock())
+	{
+		return false;
+	}
+
+	int thread = osGetRunningThread();
+	bool endOfLine = (ch == '\r' || ch == '\n');
+
+	//Once a line has lost characters the rest of it is dropped too, so a partial line is never sent
+	if (logDropping[thread])
+	{
+		logDropping[thread] = !endOfLine;
+		return true;
+	}
+
+	//Take a free buffer at the start of a line, if there are none the line is dropped instead of waiting
+	if (logLines[thread] == EMPTY_INDEX)
+	{
+		uint32_t line;
+		if (!osQueueGet(logFreeQueue, &line))
+		{
+			uint32_t state = osEnterCritical();
+			logDropped++;
+			osExitCritical(state);
+
+			logDropping[thread] = !endOfLine;
+			return true;
+		}
+		logLines[thread] = line;
+		logLengths[thread] = 0;
+	}
+
+	char* buffer = logBuffers[logLines[thread]];
+
+	//Line endings are sent as CR LF like the direct path does
+	if (endOfLine)
+	{
+		buffer[logLengths[thread]++] = '\r';
+		buffer[logLengths[thread]++] = '\n';
+	}
+	else
+	{
+		buffer[logLengths[thread]++] = ch;
+	}
+
+	//Hand the line to the logger once it ends, or when there is no longer room for a line ending
+	if (endOfLine || logLengths[thread] >= LOG_LINE_SIZE - 2)
+	{
+		osQueuePut(logReadyQueue, (uint32_t)logLines[thread] | (logLengths[thread] << 8));
+		logLines[thread] = EMPTY_INDEX;
+	}
+	return true;
+}
+
+//Returns the number of printf lines that were cut short because every line buffer was in use
+uint32_t osLogGetDropped(void)
+{
+	return logDropped;
+}
+
+//Logger thread that sends finished lines to the device
+void osLoggerThread(void* args)
+{
+	uint32_t item; //Buffer index and length of a finished line
+	uint32_t reported = 0; //Dropped count the logger last reported
+	char message[32]; //Text of the dropped line report
+
+	while (1)
+	{
+		//Sleep until a thread finishes a line
+		osWaitSetWait(logWaitSet, WAIT_FOREVER);
+
+		//Send every finished line and give its buffer back
+		while (osQueueGet(logReadyQueue, &item))
+		{
+			sendblock((uint8_t*)logBuffers[item & 0xFF], item >> 8);
+			osQueuePut(logFreeQueue, item & 0xFF);
+		}
+
+		//Let the reader know output is missing
+		uint32_t dropped = logDropped;
+		if (dropped != reported)
+		{
+			int length = sprintf(message, "<%" PRIu32 " lines dropped>\r\n", dropped - reported);
+			sendblock((uint8_t*)message, length);
+			reported = dropped;
+		}
+	}
+}
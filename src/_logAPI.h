@@ -0,0 +1,27 @@
+/*----------------------------------------------------------------------------
+ * Name: _logAPI.h
+ * Purpose: Stores any functions a part of the Log API, used to move printf output off the calling thread
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _logAPI
+#ifndef _logAPI
+#define _logAPI
+
+#include "osDefs.h"
+
+//Create the logger thread and its line buffers, returns the logger thread index or -1 if it cannot be created
+//Must be called before kernel_start since it creates a thread, until then printf writes straight to the device
+int osCreateLogger(void);
+
+//Add a character of printf output to the line buffer of the running thread, the logger sends the line once it ends or fills
+//Returns false if the caller has to write the character itself (no logger, kernel not started, or called from an ISR)
+bool osLogPutChar(int ch);
+
+//Returns the number of printf lines that were cut short because every line buffer was in use
+uint32_t osLogGetDropped(void);
+
+//Logger thread that sends finished lines to the device
+void osLoggerThread(void* args);
+
+#endif
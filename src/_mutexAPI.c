@@ -4,9 +4,12 @@
  *----------------------------------------------------------------------------
 */
 
-//Include header file for _kernelCore, _threadsCore, and _mutexAPI 
+//Include header file for _kernelCore, _threadsCore, _mutexAPI, _traceAPI, and _latencyAPI
 #include "_threadsCore.h"
+#include "_kernelCore.h"
 #include "_mutexAPI.h"
+#include "_traceAPI.h"
+#include "_latencyAPI.h"
 
 osMutex osMutexes[MAX_MUTEXES]; //Static mutex struct array
 int num_mutexes = 0; //Number of created mutexes
@@ -36,9 +39,11 @@ int osCreateMutex(void)
 }
 
 //Acquire the mutex
+//The check and the join of the waiting queue are one critical section, a release between them would find the queue empty and never wake the thread
 bool osAcquireMutex(int thread_index, int mutex_index)
 {
 	bool acquiredMutex = false; //Boolean for whether the mutex is acquired or not
+	uint32_t state = osEnterCritical();
 	
 	//Only acquire the mutex if it is available or the thread already owns the mutex
 	if(osMutexes[mutex_index].available || osMutexes[mutex_index].threadOwns == thread_index)
@@ -69,16 +74,21 @@ bool osAcquireMutex(int thread_index, int mutex_index)
 			}
 		}
 	}
+	osTrace(TRACE_MUTEX_ACQUIRE, thread_index, mutex_index, acquiredMutex);
+	osExitCritical(state);
 	return acquiredMutex; //Return whether the mutex was acquired or not (success or failed)
 }
 
 //Release the mutex
 void osReleaseMutex(int thread_index, int mutex_index)
 {
+	uint32_t state = osEnterCritical();
+	
 	//Only release the mutex if the thread already owns it
 	if(osMutexes[mutex_index].threadOwns == thread_index)
 	{
 		osMutexes[mutex_index].available = true; //Set the availbility of the mutex to true
+		osTrace(TRACE_MUTEX_RELEASE, thread_index, mutex_index, osMutexes[mutex_index].waitingQueue[0]); //EMPTY_INDEX records as 0xFF
 		
 		//Give the mutex to the next thread in the waiting queue
 		if(osMutexes[mutex_index].waitingQueue[0] != EMPTY_INDEX)
@@ -88,6 +98,8 @@ void osReleaseMutex(int thread_index, int mutex_index)
 			
 			//Move the thread back into the OS's thread waiting pool
 			osThreads[osMutexes[mutex_index].waitingQueue[0]].status = WAITING; 
+			osTrace(TRACE_WAKE, osMutexes[mutex_index].waitingQueue[0], TRACE_WAKE_MUTEX, mutex_index);
+			osLatencyReady(osMutexes[mutex_index].waitingQueue[0]); //Start timing how long it waits to run
 			
 			//Shift all the threads waiting in the waiting queue
 			//This means the next waiting thread is in the earliest index (0)
@@ -101,4 +113,6 @@ void osReleaseMutex(int thread_index, int mutex_index)
 			osMutexes[mutex_index].waitingQueue[MAX_THREADS - 1] = EMPTY_INDEX;
 		}
 	}
+	
+	osExitCritical(state);
 }
@@ -0,0 +1,96 @@
+/*----------------------------------------------------------------------------
+ * Name: _notifyAPI.c
+ * Purpose: Stores any functions a part of the direct-to-thread Notification API
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _notifyAPI, and _waitSetAPI
+#include "_kernelCore.h"
+#include "_notifyAPI.h"
+#include "_waitSetAPI.h"
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int runningThread; //Current running thread index
+
+//Send a notification to a thread, updating its notification value with the given action
+void osNotify(int thread_index, uint32_t value, int action)
+{
+	uint32_t state = osEnterCritical();
+
+	//Update the notification value
+	if (action == NOTIFY_SET_BITS)
+	{
+		osThreads[thread_index].notifyValue |= value; //Set the bits
+	}
+	else if (action == NOTIFY_INCREMENT)
+	{
+		osThreads[thread_index].notifyValue++; //Count the notification
+	}
+	else
+	{
+		osThreads[thread_index].notifyValue = value; //Overwrite the value
+	}
+	osThreads[thread_index].notifyPending = true;
+
+	//Wake the thread if it is waiting for a notification
+	if (osThreads[thread_index].notifyWaiting)
+	{
+		osWakeThread(thread_index);
+	}
+
+	//Let a thread waiting on the notifications through a wait set know there is one
+	if (osThreads[thread_index].notifyWaitSet != EMPTY_INDEX)
+	{
+		osWaitSetSignal(osThreads[thread_index].notifyWaitSet, osThreads[thread_index].notifyWaitSetMember);
+	}
+
+	osExitCritical(state);
+}
+
+//Wait up to timeout ticks (or WAIT_FOREVER) for a notification to the running thread
+bool osNotifyWait(uint32_t* value, int timeout)
+{
+	uint32_t deadline = osGetTickCount() + timeout; //Tick count at which the wait times out
+
+	while (1)
+	{
+		uint32_t state = osEnterCritical();
+
+		//Take the notification if one has been sent
+		if (osThreads[runningThread].notifyPending)
+		{
+			*value = osThreads[runningThread].notifyValue;
+			osThreads[runningThread].notifyValue = 0; //Clear the value so the next notification starts fresh
+			osThreads[runningThread].notifyPending = false;
+			osExitCritical(state);
+			return true;
+		}
+
+		//Return straight away if the caller does not want to wait
+		if (timeout == 0)
+		{
+			osExitCritical(state);
+			return false;
+		}
+
+		//Work out how long is left, a wakeup that was not a notification must not restart the timeout
+		int remaining = WAIT_FOREVER;
+		if (timeout != WAIT_FOREVER)
+		{
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if (remaining <= 0)
+			{
+				osExitCritical(state);
+				return false; //Return false when the timeout has run out
+			}
+		}
+
+		//Block until a notification arrives or the timeout runs out
+		osThreads[runningThread].notifyWaiting = true;
+		osBlockRunningThread(remaining);
+		osExitCritical(state);
+		osYield(); //Yield
+
+		osThreads[runningThread].notifyWaiting = false;
+	}
+}
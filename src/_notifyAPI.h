@@ -0,0 +1,22 @@
+/*----------------------------------------------------------------------------
+ * Name: _notifyAPI.h
+ * Purpose: Stores any functions a part of the direct-to-thread Notification API
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _notifyAPI
+#ifndef _notifyAPI
+#define _notifyAPI
+
+#include "osDefs.h"
+
+//Send a notification to a thread, updating its notification value with the given action
+//Safe to call from threads and ISRs, wakes the thread if it is waiting for a notification
+void osNotify(int thread_index, uint32_t value, int action);
+
+//Wait up to timeout ticks (or WAIT_FOREVER) for a notification to the running thread
+//Returns true and stores the notification value in value, which is then cleared, or false on timeout
+//A timeout of 0 only checks whether a notification is pending
+bool osNotifyWait(uint32_t* value, int timeout);
+
+#endif
@@ -0,0 +1,159 @@
+/*----------------------------------------------------------------------------
+ * Name: _profileAPI.c
+ * Purpose: Stores any functions a part of the Profile API, used to sample the interrupted PC with TIMER3 and count where the threads spend their time
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for uart, _kernelCore, and _profileAPI
+#include "uart.h"
+#include "_kernelCore.h"
+#include "_profileAPI.h"
+
+#ifdef OS_PROFILE
+
+//Number of slots looked at for a free one before a sample is dropped
+#define PROFILE_PROBES 8
+
+//Profile buffer, dump it from the debugger or with osProfileDump and read it with tools/profile_report.py
+osProfileBuffer osProfileBuf;
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int runningThread; //Current running thread index
+extern int num_threads; //Number of threads created
+extern volatile bool kernelRunning; //Whether the threads have started
+
+extern uint32_t getPclk(uint32_t clk_slct); //PCLK produced by a PCLKSEL code, in uart.c
+
+//Start sampling rate times a second with TIMER3, 0 samples at PROFILE_RATE
+void osProfileStart(uint32_t rate)
+{
+	if (rate == 0)
+	{
+		rate = PROFILE_RATE;
+	}
+
+	osProfileBuf.clock = SystemCoreClock;
+	osProfileBuf.rate = rate;
+	osProfileBuf.capacity = PROFILE_SLOTS;
+	osProfileBuf.maxThreads = MAX_THREADS;
+	for (int i = 0; i < num_threads; i++)
+	{
+		osProfileBuf.threadFuncs[i] = (uint32_t)(uintptr_t)osThreads[i].threadFunc;
+	}
+	osProfileBuf.magic = PROFILE_MAGIC; //Set last so a half set up buffer is never mistaken for a profile
+
+	//Power TIMER3 (bit 23 of PCONP), its PCLK is whatever bits 14~15 of PCLKSEL1 select, 1/4 of the system clock by default
+	LPC_SC->PCONP |= 1 << 23;
+	LPC_TIM3->TCR = 2; //Hold the counter in reset while it is set up
+	LPC_TIM3->PR = 0;
+	LPC_TIM3->MR0 = getPclk(LPC_SC->PCLKSEL1 >> 14) / rate - 1;
+	LPC_TIM3->MCR = 3; //Interrupt and reset the counter on MR0
+	LPC_TIM3->IR = 1; //Clear an old MR0 interrupt
+
+	//The strongest priority lets it sample inside other interrupt handlers
+	//Critical sections still hold a sample back until they end, so time in them shows up on the instruction after
+	NVIC_SetPriority(TIMER3_IRQn, 0);
+	NVIC_EnableIRQ(TIMER3_IRQn);
+	LPC_TIM3->TCR = 1; //Start the timer
+}
+
+//Stop sampling
+void osProfileStop(void)
+{
+	LPC_TIM3->TCR = 0; //Stop the timer
+	NVIC_DisableIRQ(TIMER3_IRQn);
+}
+
+//Clear the samples
+void osProfileReset(void)
+{
+	uint32_t state = osEnterCritical();
+	for (int i = 0; i < PROFILE_SLOTS; i++)
+	{
+		osProfileBuf.slots[i].count = 0;
+	}
+	osProfileBuf.samples = 0;
+	osProfileBuf.dropped = 0;
+	osExitCritical(state);
+}
+
+//Count one sample
+void osProfileSample(uint32_t* frame, uint32_t excReturn)
+{
+	uint32_t pc = frame[6]; //The exception frame holds R0, R1, R2, R3, R12, LR, PC, and xPSR
+	uint32_t thread;
+
+	LPC_TIM3->IR = 1; //Clear the MR0 interrupt
+
+	//Bit 3 of EXC_RETURN is clear when the timer interrupted another handler
+	if ((excReturn & 0x8) == 0)
+	{
+		thread = PROFILE_THREAD_ISR;
+	}
+	else if (!kernelRunning)
+	{
+		thread = PROFILE_THREAD_MAIN;
+	}
+	else
+	{
+		thread = runningThread;
+	}
+
+	osProfileBuf.samples++;
+
+	//Look for the slot of this pair, or a free one to start it in
+	//PCs are halfword aligned, so bit 0 carries no information
+	uint32_t slot = ((pc >> 1) ^ (pc >> 9) ^ (thread * 0x9E5)) & (PROFILE_SLOTS - 1);
+	for (int i = 0; i < PROFILE_PROBES; i++)
+	{
+		osProfileSlot* entry = &osProfileBuf.slots[slot];
+
+		if (entry->count == 0)
+		{
+			entry->pc = pc;
+			entry->thread = thread;
+			entry->count = 1;
+			return;
+		}
+		if (entry->pc == pc && entry->thread == thread)
+		{
+			entry->count++;
+			return;
+		}
+		slot = (slot + 1) & (PROFILE_SLOTS - 1);
+	}
+
+	osProfileBuf.dropped++; //The table is too full around this slot
+}
+
+//Send the whole profile buffer over a UART port
+void osProfileDump(uint32_t portNum)
+{
+	UARTSend(portNum, (uint8_t*)&osProfileBuf, sizeof(osProfileBuf));
+}
+
+#else
+
+//Profiling is compiled out, these do nothing
+//osProfileSample is still needed since TIMER3_IRQHandler branches to it, the timer is never started so it never runs
+void osProfileStart(uint32_t rate)
+{
+}
+
+void osProfileStop(void)
+{
+}
+
+void osProfileReset(void)
+{
+}
+
+void osProfileSample(uint32_t* frame, uint32_t excReturn)
+{
+}
+
+void osProfileDump(uint32_t portNum)
+{
+}
+
+#endif
@@ -0,0 +1,58 @@
+/*----------------------------------------------------------------------------
+ * Name: _profileAPI.h
+ * Purpose: Stores any functions a part of the Profile API, used to sample the interrupted PC with TIMER3 and count where the threads spend their time
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _profileAPI
+#ifndef _profileAPI
+#define _profileAPI
+
+#include "osDefs.h"
+
+//Magic number at the start of the profile buffer ('PROF' in memory), so the host tool can find it in a dump
+#define PROFILE_MAGIC 0x464F5250
+
+//Thread recorded for samples that did not land in a thread
+#define PROFILE_THREAD_ISR 0xFF //An interrupt handler was running
+#define PROFILE_THREAD_MAIN 0xFE //main was running before kernel_start
+
+//Define one profile slot, the number of samples that landed on one PC in one thread
+typedef struct profile_slot_struct
+{
+	uint32_t pc; //Address of the interrupted instruction
+	uint32_t thread; //Thread that was running (or PROFILE_THREAD_ISR or PROFILE_THREAD_MAIN)
+	uint32_t count; //Number of samples, 0 for a free slot
+}osProfileSlot;
+
+//Define the profile buffer, the host tool reads it as one block of memory so the header describes everything it needs
+typedef struct profile_buffer_struct
+{
+	uint32_t magic; //PROFILE_MAGIC
+	uint32_t clock; //CPU clock in Hz
+	uint32_t rate; //Sampling rate in Hz
+	volatile uint32_t samples; //Number of samples taken
+	volatile uint32_t dropped; //Number of samples that found no free slot
+	uint32_t capacity; //Number of slots
+	uint32_t maxThreads; //Number of entries in threadFuncs
+	uint32_t threadFuncs[MAX_THREADS]; //Function of each thread, to name threads from the ELF symbols
+	osProfileSlot slots[PROFILE_SLOTS]; //Hash table of (PC, thread) pairs
+}osProfileBuffer;
+
+//Start sampling rate times a second with TIMER3 (0 for PROFILE_RATE), call after the threads are created so they can be named
+//The samples keep counting from where they were, call osProfileReset first for a new profile
+void osProfileStart(uint32_t rate);
+
+//Stop sampling
+void osProfileStop(void);
+
+//Clear the samples
+void osProfileReset(void);
+
+//Count one sample, called by TIMER3_IRQHandler in svc_call.s with the stacked registers and the EXC_RETURN value
+void osProfileSample(uint32_t* frame, uint32_t excReturn);
+
+//Send the whole profile buffer over a UART port for tools/profile_report.py, stop sampling first for a consistent profile
+void osProfileDump(uint32_t portNum);
+
+#endif
@@ -0,0 +1,141 @@
+/*----------------------------------------------------------------------------
+ * Name: _queueAPI.c
+ * Purpose: Stores any functions a part of the lock-free Queue API
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _queueAPI and _waitSetAPI
+#include "_queueAPI.h"
+#include "_waitSetAPI.h"
+
+//Mask used to wrap a queue position into a slot index
+#define QUEUE_MASK (QUEUE_SIZE - 1)
+
+osQueue osQueues[MAX_QUEUES]; //Static queue struct array
+int num_queues = 0; //Number of created queues
+
+//Create a lock-free queue, returns the queue index or -1 if the queue cannot be created
+int osCreateQueue(void)
+{
+	//Create the queue if the number of queues is less than the maximum
+	if (num_queues < MAX_QUEUES)
+	{
+		osQueues[num_queues].ID = num_queues; //Set the ID of the queue to the current index
+		osQueues[num_queues].head = 0; //No items have been put yet
+		osQueues[num_queues].tail = 0; //No items have been taken yet
+		osQueues[num_queues].waitSet = EMPTY_INDEX; //The queue is not part of a wait set yet
+
+		//Each slot starts with a sequence equal to its position, which marks it as free for the first producer
+		for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+		{
+			osQueues[num_queues].slots[i].sequence = i;
+		}
+
+		num_queues++; //Increment the number of queues
+		return num_queues - 1; //Return the queue index (position of the queue in the array)
+	}
+	return -1; //Return -1 if the queue cannot be created
+}
+
+//Put an item into the queue, returns false if the queue is full
+//A producer claims a position by advancing head with LDREX/STREX, so it can be preempted by another producer
+//(including an ISR) at any point without either of them waiting on a lock
+bool osQueuePut(int queue_index, uint32_t item)
+{
+	osQueue* queue = &osQueues[queue_index]; //Queue being written
+	osQueueSlot* slot; //Slot claimed by this producer
+	uint32_t position; //Position claimed by this producer
+
+	while (1)
+	{
+		position = __LDREXW(&queue->head); //Read head and open the exclusive monitor
+		slot = &queue->slots[position & QUEUE_MASK];
+		int32_t difference = (int32_t)(slot->sequence - position);
+
+		if (difference == 0)
+		{
+			//The slot is free, try to claim it by moving head forward
+			//STREX fails if another producer or an exception touched head since LDREX, in which case try again
+			if (__STREXW(position + 1, &queue->head) == 0)
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			//The slot still holds an item that has not been consumed, so the queue is full
+			__CLREX();
+			return false;
+		}
+		else
+		{
+			//Another producer already claimed this position, reload head and try again
+			__CLREX();
+		}
+	}
+
+	slot->item = item; //Store the item in the claimed slot
+	__DMB(); //Make sure the item is visible before the slot is published
+	slot->sequence = position + 1; //Publish the slot to the consumers
+
+	//Let a thread waiting on the queue through a wait set know there is an item
+	if (queue->waitSet != EMPTY_INDEX)
+	{
+		osWaitSetSignal(queue->waitSet, queue->waitSetMember);
+	}
+	return true;
+}
+
+//Take the oldest item out of the queue, returns false if the queue is empty
+//Consumers claim positions the same way producers do, so several consumers may share one queue
+bool osQueueGet(int queue_index, uint32_t* item)
+{
+	osQueue* queue = &osQueues[queue_index]; //Queue being read
+	osQueueSlot* slot; //Slot claimed by this consumer
+	uint32_t position; //Position claimed by this consumer
+
+	while (1)
+	{
+		position = __LDREXW(&queue->tail); //Read tail and open the exclusive monitor
+		slot = &queue->slots[position & QUEUE_MASK];
+		int32_t difference = (int32_t)(slot->sequence - (position + 1));
+
+		if (difference == 0)
+		{
+			//The slot has been published, try to claim it by moving tail forward
+			if (__STREXW(position + 1, &queue->tail) == 0)
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			//The slot has not been published yet, so the queue is empty
+			//A producer that claimed this slot but was preempted before publishing also lands here
+			__CLREX();
+			return false;
+		}
+		else
+		{
+			//Another consumer already claimed this position, reload tail and try again
+			__CLREX();
+		}
+	}
+
+	*item = slot->item; //Copy the item out of the claimed slot
+	__DMB(); //Make sure the item is read before the slot is handed back
+	slot->sequence = position + QUEUE_SIZE; //Free the slot for the producer one lap ahead
+	return true;
+}
+
+//Returns the number of items currently stored in the queue
+//This is only a snapshot since producers and consumers may be running concurrently
+uint32_t osQueueCount(int queue_index)
+{
+	//Read tail before head so the difference can never go negative
+	uint32_t tail = osQueues[queue_index].tail;
+	uint32_t count = osQueues[queue_index].head - tail;
+
+	//Items may have been taken between the two reads, so never report more than the queue can hold
+	return (count > QUEUE_SIZE) ? QUEUE_SIZE : count;
+}
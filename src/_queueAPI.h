@@ -0,0 +1,27 @@
+/*----------------------------------------------------------------------------
+ * Name: _queueAPI.h
+ * Purpose: Stores any functions a part of the lock-free Queue API
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _queueAPI
+#ifndef _queueAPI
+#define _queueAPI
+
+#include "osDefs.h"
+
+//Create a lock-free queue, returns the queue index or -1 if the queue cannot be created
+int osCreateQueue(void);
+
+//Put an item into the queue, returns false if the queue is full
+//Safe to call from any thread or ISR since no lock is ever held
+bool osQueuePut(int queue_index, uint32_t item);
+
+//Take the oldest item out of the queue, returns false if the queue is empty
+//Safe to call from any thread or ISR since no lock is ever held
+bool osQueueGet(int queue_index, uint32_t* item);
+
+//Returns the number of items currently stored in the queue
+uint32_t osQueueCount(int queue_index);
+
+#endif
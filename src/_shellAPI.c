@@ -0,0 +1,234 @@
+/*----------------------------------------------------------------------------
+ * Name: _shellAPI.c
+ * Purpose: Stores any functions a part of the Shell API, a command line on a UART port that shows the kernel's state while it runs
+ *----------------------------------------------------------------------------
+*/
+
+//Commands (type help on the port for the list):
+//	threads				one line per thread: state, timeslice, CPU load, run time, and stack high-water mark
+//	mutexes				one line per mutex: owner and the threads waiting for it
+//	stats				tick count, switch count, and interrupt and system load
+//	timeslice <t> <ticks>	change how long thread t runs before the scheduler moves on
+//	priority			the scheduler is round-robin, so this explains that there are no priorities to change
+//Each line is copied in its own short critical section and sent after it ends, so interrupts are never off while the UART sends
+
+//Include header file for stdio, stdlib, string, uart, _kernelCore, _threadsCore, _cpuAPI, _logAPI, and _shellAPI
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "uart.h"
+#include "_kernelCore.h"
+#include "_threadsCore.h"
+#include "_cpuAPI.h"
+#include "_logAPI.h"
+#include "_shellAPI.h"
+
+int shellThread = EMPTY_INDEX; //Shell thread index (EMPTY_INDEX until osCreateShell succeeds)
+uint32_t shellPort; //UART port the shell talks on
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int num_threads; //Number of threads created
+extern osMutex osMutexes[MAX_MUTEXES]; //Static mutex struct array
+extern int num_mutexes; //Number of created mutexes
+
+//Names of the thread states, indexed by the state value
+const char* const shellStates[] = {"CREATED", "RUNNING", "WAITING", "SLEEPING", "BLOCKED"};
+
+//Set up the UART port and create the shell thread
+int osCreateShell(uint32_t portNum, uint32_t baudrate)
+{
+	//Only one shell is needed
+	if (shellThread != EMPTY_INDEX)
+	{
+		return shellThread;
+	}
+
+	if (UARTInit(portNum, baudrate) == FALSE)
+	{
+		return -1; //Return -1 if the port cannot be set up
+	}
+	shellPort = portNum;
+
+	shellThread = create_thread(osShellThread);
+	return shellThread;
+}
+
+//Send a string to the shell port
+void shellSend(const char* text)
+{
+	UARTSend(shellPort, (uint8_t*)text, strlen(text));
+}
+
+//Read a command line, echoing it back, returns its length
+uint32_t shellReadLine(char* line)
+{
+	uint32_t length = 0;
+	uint8_t ch;
+
+	while (1)
+	{
+		//Sleeps until the receive interrupt has a character
+		if (UARTRecieve(shellPort, &ch, 1) != 1)
+		{
+			continue;
+		}
+
+		if (ch == '\r' || ch == '\n')
+		{
+			shellSend("\r\n");
+			line[length] = '\0';
+			return length;
+		}
+		else if ((ch == '\b' || ch == 0x7F) && length > 0)
+		{
+			length--;
+			shellSend("\b \b"); //Rub the character out on the terminal
+		}
+		else if (ch >= ' ' && ch < 0x7F && length < SHELL_LINE_SIZE - 1)
+		{
+			line[length++] = ch;
+			UARTSend(shellPort, &ch, 1);
+		}
+	}
+}
+
+//threads command, one line per thread
+void shellThreads(void)
+{
+	char text[64]; //One line of output
+
+	shellSend("id func       state    slice   cpu%  run_ms   stack\r\n");
+	for (int i = 0; i < num_threads; i++)
+	{
+		//Copy what the line needs in one go so it all comes from the same moment
+		uint32_t state = osEnterCritical();
+		int status = osThreads[i].status;
+		int timeslice = osThreads[i].timeslice;
+		uint32_t func = (uint32_t)(uintptr_t)osThreads[i].threadFunc;
+		osExitCritical(state);
+
+		uint32_t load = osGetThreadLoad(i);
+		uint32_t runMs = (uint32_t)(osGetThreadCycles(i) / (SystemCoreClock / 1000));
+
+		snprintf(text, sizeof(text), "%2d %08" PRIx32 " %-8s %5d %3" PRIu32 ".%" PRIu32 "%% %7" PRIu32 " %3" PRIu32 "/%u\r\n", i, func,
+			(status >= CREATED && status <= BLOCKED) ? shellStates[status] : "?", timeslice,
+			load / 10, load % 10, runMs, osGetStackHighWater(i), THREAD_STACK_SIZE);
+		shellSend(text);
+	}
+}
+
+//mutexes command, one line per mutex
+void shellMutexes(void)
+{
+	char text[64]; //One line of output
+	int waiting[MAX_THREADS]; //Copy of the waiting queue
+
+	shellSend("id owner waiting\r\n");
+	for (int i = 0; i < num_mutexes; i++)
+	{
+		uint32_t state = osEnterCritical();
+		bool available = osMutexes[i].available;
+		int owner = osMutexes[i].threadOwns;
+		memcpy(waiting, osMutexes[i].waitingQueue, sizeof(waiting));
+		osExitCritical(state);
+
+		int length = snprintf(text, sizeof(text), "%2d ", i);
+		length += available ? snprintf(text + length, sizeof(text) - length, "%5s", "-") : snprintf(text + length, sizeof(text) - length, "%5d", owner);
+
+		//The waiting queue is packed from index 0, the first empty entry ends it, stop while there is still room for a thread index and the line end
+		for (int j = 0; j < MAX_THREADS && waiting[j] != EMPTY_INDEX && length < (int)sizeof(text) - 8; j++)
+		{
+			length += snprintf(text + length, sizeof(text) - length, " %d", waiting[j]);
+		}
+		strcpy(text + length, "\r\n");
+		shellSend(text);
+	}
+}
+
+//stats command, the kernel wide counters
+void shellStats(void)
+{
+	char text[64]; //One line of output
+	uint32_t system = osGetSystemLoad();
+	uint32_t isr = osGetISRLoad();
+
+	//One line per pair of counters, so even the longest values fit in the line buffer
+	snprintf(text, sizeof(text), "ticks %" PRIu32 ", switches %" PRIu32 "\r\n", osGetTickCount(), osGetSwitchCount());
+	shellSend(text);
+	snprintf(text, sizeof(text), "system load %" PRIu32 ".%" PRIu32 "%%, interrupt load %" PRIu32 ".%" PRIu32 "%%\r\n",
+		system / 10, system % 10, isr / 10, isr % 10);
+	shellSend(text);
+	snprintf(text, sizeof(text), "dropped log lines %" PRIu32 "\r\n", osLogGetDropped());
+	shellSend(text);
+}
+
+//timeslice command, changes the timeslice of a thread
+void shellTimeslice(char* args)
+{
+	char text[64]; //One line of output
+	char* end;
+	long thread = strtol(args, &end, 10);
+	long ticks = strtol(end, &end, 10);
+
+	if (end == args || !osSetTimeslice((int)thread, (int)ticks))
+	{
+		shellSend("usage: timeslice <thread> <ticks>, ticks at least 1\r\n");
+		return;
+	}
+	snprintf(text, sizeof(text), "thread %ld now runs for %ld ticks at a time\r\n", thread, ticks);
+	shellSend(text);
+}
+
+//Shell thread
+void osShellThread(void* args)
+{
+	char line[SHELL_LINE_SIZE]; //Command line being read
+
+	shellSend("\r\nkernel shell, type help for the commands\r\n");
+
+	while (1)
+	{
+		shellSend("> ");
+		if (shellReadLine(line) == 0)
+		{
+			continue;
+		}
+
+		//Split the command from its arguments
+		char* args = strchr(line, ' ');
+		if (args != NULL)
+		{
+			*args++ = '\0';
+		}
+		else
+		{
+			args = line + strlen(line);
+		}
+
+		if (strcmp(line, "threads") == 0 || strcmp(line, "top") == 0)
+		{
+			shellThreads();
+		}
+		else if (strcmp(line, "mutexes") == 0)
+		{
+			shellMutexes();
+		}
+		else if (strcmp(line, "stats") == 0)
+		{
+			shellStats();
+		}
+		else if (strcmp(line, "timeslice") == 0)
+		{
+			shellTimeslice(args);
+		}
+		else if (strcmp(line, "priority") == 0)
+		{
+			shellSend("threads have no priorities, the scheduler runs them round-robin, use timeslice to give one more time\r\n");
+		}
+		else
+		{
+			shellSend("commands: threads (or top), mutexes, stats, timeslice <thread> <ticks>, priority\r\n");
+		}
+	}
+}
@@ -0,0 +1,21 @@
+/*----------------------------------------------------------------------------
+ * Name: _shellAPI.h
+ * Purpose: Stores any functions a part of the Shell API, a command line on a UART port that shows the kernel's state while it runs
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _shellAPI
+#ifndef _shellAPI
+#define _shellAPI
+
+#include "osDefs.h"
+
+//Set up the UART port and create the shell thread, returns the shell thread index or -1 if it cannot be created
+//Must be called before kernel_start since it creates a thread, use a port printf does not write to
+int osCreateShell(uint32_t portNum, uint32_t baudrate);
+
+//Shell thread, reads a command line at a time and answers it
+//It spends its time blocked on the UART, so it only takes CPU time while a command runs
+void osShellThread(void* args);
+
+#endif
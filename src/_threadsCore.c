@@ -16,15 +16,15 @@ extern int runningThread; //Current running thread index
 //Obtains the initial location of MSP by looking it up in the vector table
 uint32_t* getMSPInitialLocation(void)
 {
-	uint32_t* msp = 0; //MSP location is stored at address 0x00 in the vector table
-	return (uint32_t *) *msp; //Return address of where MSP is stored
+	//MSP location is stored at address 0x00 in the vector table, the host port returns the top of its stack area instead
+	return portInitialMSP(); //Return address of where MSP is stored
 }
 
 //Returns the address of a new PSP with an offset of "offset" bytes from MSP
 uint32_t* getNewThreadStack(uint32_t offset)
 {
 	//Set the newThreadStack address to initially be the MSP location
-	uint32_t newThreadStack = (uint32_t)getMSPInitialLocation();
+	uintptr_t newThreadStack = (uintptr_t)getMSPInitialLocation();
 	
 	newThreadStack -= offset; //Decrement the address by the offset
 	
@@ -63,30 +63,46 @@ int create_thread(void (*func)(void* args))
 		osThreads[num_threads].threadFunc = func; //Store the function pointer for the thread
 		osThreads[num_threads].threadStack = newThreadStack; //Store the stack pointer location for this thread stack pointer
 		osThreads[num_threads].timer = TIMESLICE; //Set the timeslice for the thread
+		osThreads[num_threads].timeslice = TIMESLICE; //Every thread starts with the default timeslice
+		osThreads[num_threads].blockTimer = WAIT_FOREVER; //The thread is not blocked
+		osThreads[num_threads].timedOut = false;
+		osThreads[num_threads].notifyValue = 0; //No notifications have been sent yet
+		osThreads[num_threads].notifyPending = false;
+		osThreads[num_threads].notifyWaiting = false;
+		osThreads[num_threads].notifyWaitSet = EMPTY_INDEX; //Notifications are not part of a wait set yet
+		osThreads[num_threads].runCycles = 0; //The thread has not run yet
 		
-		//Setup the stack for the new thread
-		//Set 24th bit of the SP, this sets xpsr (status register)
-		*(--osThreads[num_threads].threadStack) = 1<<24;
-		
-		//Store the PC as the function we will be running
-		*(--osThreads[num_threads].threadStack) = (uint32_t)func;	
-		
-		//Store the next registers LR, R12, R3, R2, R1, R0
-		//LR=0xE, R12=0xD, R3=0xC, R2=0xB, R1=0xA, R0=0x9
-		for (uint32_t i = 0xE; i > 0x8; i--) 
+		//Paint the stack from the bottom of the thread's space up to where it starts, so osGetStackHighWater can see how deep it went
+		osThreads[num_threads].stackBase = getMSPInitialLocation() - (MSR_STACK_SIZE + (num_threads + 1)*THREAD_STACK_SIZE) / sizeof(uint32_t);
+		for (uint32_t* word = osThreads[num_threads].stackBase; word < newThreadStack; word++)
 		{
-			*(--osThreads[num_threads].threadStack) = i;
+			*word = STACK_PAINT;
 		}
 		
-		//Store the next registers R11 through R4
-		//R11=0xB, R10=0xA, R9=0x9, R8=0x8, R7=0x7, R6=0x6, R5=0x5, R4=0x4
-		for (uint32_t i = 0xB; i > 0x3; i--) 
-		{
-			*(--osThreads[num_threads].threadStack) = i;
-		}
+		//Setup the stack for the new thread, on the board this is the exception frame the first switch pops
+		osThreads[num_threads].threadStack = portInitThreadStack(num_threads, newThreadStack, func);
 		
 		num_threads++; //Increment the number of threads
 		return num_threads - 1; //Return the thread index (position of the thread in the array)
 	}
 	return -1; //Return -1 if the thread cannot be created
 }
+
+//Returns the most stack a thread has used in bytes, found by looking for the lowest word that no longer holds the paint
+//A thread that used all of its stack reports THREAD_STACK_SIZE, and it may have written past the end into the next thread
+uint32_t osGetStackHighWater(int thread_index)
+{
+	if (thread_index < 0 || thread_index >= num_threads)
+	{
+		return 0;
+	}
+	
+	uint32_t untouched = 0; //Number of bytes at the bottom of the stack that still hold the paint
+	uint32_t* word = osThreads[thread_index].stackBase;
+	while (untouched < THREAD_STACK_SIZE && *word == STACK_PAINT)
+	{
+		untouched += sizeof(uint32_t);
+		word++;
+	}
+	return THREAD_STACK_SIZE - untouched;
+}
@@ -23,6 +23,9 @@ uint32_t* getNewThreadStack(uint32_t offset);
 //Creates one single thread, returns the thread ID or -1 if the thread cannot be created
 int create_thread(void (*func)(void* args));
 
+//Returns the most stack a thread has used in bytes (its high-water mark)
+uint32_t osGetStackHighWater(int thread_index);
+
 //Thread function type
 typedef void *threadFunc(void);
 
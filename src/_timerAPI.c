@@ -0,0 +1,200 @@
+/*----------------------------------------------------------------------------
+ * Name: _timerAPI.c
+ * Purpose: Stores any functions a part of the software Timer API
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _threadsCore, and _timerAPI
+#include "_kernelCore.h"
+#include "_threadsCore.h"
+#include "_timerAPI.h"
+
+osTimer osTimers[MAX_TIMERS]; //Static timer struct array
+int num_timers = 0; //Number of created timers
+
+//Active timers form a doubly linked list ordered by expiry, so the SysTick handler only ever looks at the head
+//Starting a timer walks the list to find its place, stopping one and expiring the head only relink neighbours
+int activeTimerHead = EMPTY_INDEX; //Index of the timer that expires first
+int timerServiceThread = EMPTY_INDEX; //Index of the timer service thread
+
+extern volatile uint32_t osTickCount; //Number of ticks since the kernel started
+
+//Link a timer into the active list in expiry order, must be called inside a critical section
+void timerInsert(int timer_index)
+{
+	int previous = EMPTY_INDEX; //Timer that will expire just before this one
+	int current = activeTimerHead; //Timer that will expire just after this one
+
+	//Find the first timer that expires later than this one
+	//The difference is compared as signed so the order stays correct when the tick count wraps around
+	while (current != EMPTY_INDEX && (int32_t)(osTimers[current].expiry - osTimers[timer_index].expiry) <= 0)
+	{
+		previous = current;
+		current = osTimers[current].next;
+	}
+
+	osTimers[timer_index].previous = previous;
+	osTimers[timer_index].next = current;
+
+	if (previous == EMPTY_INDEX)
+	{
+		activeTimerHead = timer_index; //The timer expires first so it becomes the head
+	}
+	else
+	{
+		osTimers[previous].next = timer_index;
+	}
+
+	if (current != EMPTY_INDEX)
+	{
+		osTimers[current].previous = timer_index;
+	}
+
+	osTimers[timer_index].active = true;
+}
+
+//Unlink a timer from the active list, must be called inside a critical section
+void timerRemove(int timer_index)
+{
+	int previous = osTimers[timer_index].previous;
+	int next = osTimers[timer_index].next;
+
+	if (previous == EMPTY_INDEX)
+	{
+		activeTimerHead = next; //The timer was the head so the next timer becomes the head
+	}
+	else
+	{
+		osTimers[previous].next = next;
+	}
+
+	if (next != EMPTY_INDEX)
+	{
+		osTimers[next].previous = previous;
+	}
+
+	osTimers[timer_index].active = false;
+}
+
+//Create a one-shot or periodic software timer, returns the timer index or -1 if the timer cannot be created
+int osCreateTimer(void (*callback)(void* arg), void* arg, int mode)
+{
+	//Create the timer service thread along with the first timer
+	if (timerServiceThread == EMPTY_INDEX)
+	{
+		timerServiceThread = create_thread(osTimerThread);
+		if (timerServiceThread == -1)
+		{
+			timerServiceThread = EMPTY_INDEX;
+			return -1; //Return -1 if the service thread cannot be created
+		}
+	}
+
+	//Create the timer if the number of timers is less than the maximum
+	if (num_timers < MAX_TIMERS)
+	{
+		osTimers[num_timers].ID = num_timers; //Set the ID of the timer to the current index
+		osTimers[num_timers].callback = callback; //Store the function pointer for the callback
+		osTimers[num_timers].arg = arg; //Store the argument for the callback
+		osTimers[num_timers].mode = mode; //Set the mode of the timer
+		osTimers[num_timers].period = 0; //The period is set when the timer is started
+		osTimers[num_timers].active = false; //The timer is not running yet
+		osTimers[num_timers].next = EMPTY_INDEX;
+		osTimers[num_timers].previous = EMPTY_INDEX;
+
+		num_timers++; //Increment the number of timers
+		return num_timers - 1; //Return the timer index (position of the timer in the array)
+	}
+	return -1; //Return -1 if the timer cannot be created
+}
+
+//Start (or restart) a timer so it expires after period ticks (ms), returns false if the period is 0
+bool osTimerStart(int timer_index, uint32_t period)
+{
+	//A timer with no period would expire on every tick
+	if (period == 0)
+	{
+		return false;
+	}
+
+	uint32_t state = osEnterCritical();
+
+	//Restarting a running timer moves it to its new place in the list
+	if (osTimers[timer_index].active)
+	{
+		timerRemove(timer_index);
+	}
+
+	osTimers[timer_index].period = period;
+	osTimers[timer_index].expiry = osTickCount + period;
+	timerInsert(timer_index);
+
+	osExitCritical(state);
+	return true;
+}
+
+//Stop a timer, its callback will not run until it is started again
+void osTimerStop(int timer_index)
+{
+	uint32_t state = osEnterCritical();
+
+	if (osTimers[timer_index].active)
+	{
+		timerRemove(timer_index);
+	}
+
+	osExitCritical(state);
+}
+
+//Returns whether the timer is currently running
+bool osTimerIsActive(int timer_index)
+{
+	return osTimers[timer_index].active;
+}
+
+//Called by the SysTick handler every tick to wake the timer service thread when a timer expires
+//Only the head of the list has to be checked since it is the first timer to expire
+void osTimerTick(void)
+{
+	if (activeTimerHead != EMPTY_INDEX && (int32_t)(osTickCount - osTimers[activeTimerHead].expiry) >= 0)
+	{
+		osWakeThread(timerServiceThread);
+	}
+}
+
+//Timer service thread, runs the callbacks of expired timers
+void osTimerThread(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		uint32_t state = osEnterCritical();
+		int expired = activeTimerHead; //Timer at the head of the list
+
+		if (expired != EMPTY_INDEX && (int32_t)(osTickCount - osTimers[expired].expiry) >= 0)
+		{
+			timerRemove(expired);
+
+			//Periodic timers are reloaded from their previous expiry so they do not drift
+			if (osTimers[expired].mode == TIMER_PERIODIC)
+			{
+				osTimers[expired].expiry += osTimers[expired].period;
+				timerInsert(expired);
+			}
+
+			void (*callback)(void* arg) = osTimers[expired].callback;
+			void* arg = osTimers[expired].arg;
+			osExitCritical(state);
+
+			//Run the callback outside of the critical section
+			callback(arg);
+		}
+		else
+		{
+			//Block until the SysTick handler sees the head timer expire
+			osBlockRunningThread(WAIT_FOREVER);
+			osExitCritical(state);
+			osYield(); //Yield
+		}
+	}
+}
@@ -0,0 +1,32 @@
+/*----------------------------------------------------------------------------
+ * Name: _timerAPI.h
+ * Purpose: Stores any functions a part of the software Timer API
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _timerAPI
+#ifndef _timerAPI
+#define _timerAPI
+
+#include "osDefs.h"
+
+//Create a one-shot or periodic software timer, returns the timer index or -1 if the timer cannot be created
+//The first timer created also creates the timer service thread, so timers must be created before kernel_start
+int osCreateTimer(void (*callback)(void* arg), void* arg, int mode);
+
+//Start (or restart) a timer so it expires after period ticks (ms), returns false if the period is 0
+bool osTimerStart(int timer_index, uint32_t period);
+
+//Stop a timer, its callback will not run until it is started again
+void osTimerStop(int timer_index);
+
+//Returns whether the timer is currently running
+bool osTimerIsActive(int timer_index);
+
+//Called by the SysTick handler every tick to wake the timer service thread when a timer expires
+void osTimerTick(void);
+
+//Timer service thread, runs the callbacks of expired timers
+void osTimerThread(void* args);
+
+#endif
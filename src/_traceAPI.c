@@ -0,0 +1,79 @@
+/*----------------------------------------------------------------------------
+ * Name: _traceAPI.c
+ * Purpose: Stores any functions a part of the Trace API, used to record scheduler events into a RAM ring
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _traceAPI, and uart (a port with host files has none)
+#include "_kernelCore.h"
+#include "_traceAPI.h"
+#ifndef PORT_HOST_FILES
+	#include "uart.h"
+#endif
+
+#ifdef OS_TRACE
+
+//Trace buffer, dump it from the debugger or with osTraceDump and convert it with tools/trace_to_chrome.py
+osTraceBuffer osTraceBuf;
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int num_threads; //Number of threads created
+
+//Start recording, called by kernel_start once every thread has been created
+void osTraceStart(void)
+{
+	osTraceBuf.head = 0;
+	osTraceBuf.clock = SystemCoreClock;
+	osTraceBuf.capacity = TRACE_RING_EVENTS;
+	osTraceBuf.maxThreads = MAX_THREADS;
+	for (int i = 0; i < num_threads; i++)
+	{
+		osTraceBuf.threadFuncs[i] = (uint32_t)(uintptr_t)osThreads[i].threadFunc;
+	}
+	osTraceBuf.magic = TRACE_MAGIC; //Set last so a half set up buffer is never mistaken for a trace
+}
+
+//Record an event
+void osTraceRecord(uint32_t type, uint32_t thread, uint32_t a, uint32_t b)
+{
+	uint32_t state = osEnterCritical();
+	osTraceEvent* event = &osTraceBuf.events[osTraceBuf.head++ & (TRACE_RING_EVENTS - 1)];
+
+	event->cycles = portCycles();
+	*(uint32_t*)&event->type = (type & 0xFF) | ((thread & 0xFF) << 8) | ((a & 0xFF) << 16) | (b << 24); //All four bytes in one store, -1 records as 0xFF
+
+	osExitCritical(state);
+}
+
+//Send the whole trace buffer over a UART port
+void osTraceDump(uint32_t portNum)
+{
+#ifdef PORT_HOST_FILES
+	//The host and QEMU ports have no UART but can write host files, the dump goes to trace.bin
+	FILE* file = fopen("trace.bin", "wb");
+	if (file != NULL)
+	{
+		fwrite(&osTraceBuf, sizeof(osTraceBuf), 1, file);
+		fclose(file);
+	}
+#else
+	UARTSend(portNum, (uint8_t*)&osTraceBuf, sizeof(osTraceBuf));
+#endif
+}
+
+#else
+
+//Tracing is compiled out, these do nothing
+void osTraceStart(void)
+{
+}
+
+void osTraceRecord(uint32_t type, uint32_t thread, uint32_t a, uint32_t b)
+{
+}
+
+void osTraceDump(uint32_t portNum)
+{
+}
+
+#endif
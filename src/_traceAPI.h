@@ -0,0 +1,75 @@
+/*----------------------------------------------------------------------------
+ * Name: _traceAPI.h
+ * Purpose: Stores any functions a part of the Trace API, used to record scheduler events into a RAM ring
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _traceAPI
+#ifndef _traceAPI
+#define _traceAPI
+
+#include "osDefs.h"
+
+//Event types
+#define TRACE_SWITCH 1 //The scheduler picked a new thread, a = next thread, b = reason
+#define TRACE_WAKE 2 //A thread became runnable, a = cause
+#define TRACE_MUTEX_ACQUIRE 3 //A thread asked for a mutex, a = mutex, b = 1 if it got it or 0 if it blocked
+#define TRACE_MUTEX_RELEASE 4 //A thread released a mutex, a = mutex, b = thread it was handed to (0xFF if none)
+#define TRACE_ISR_ENTER 5 //An interrupt handler started, a = exception number
+#define TRACE_ISR_EXIT 6 //An interrupt handler finished, a = exception number
+
+//Reasons for a switch
+#define TRACE_REASON_YIELD 0 //The thread called osYield
+#define TRACE_REASON_TIMESLICE 1 //The timeslice ran out in the SysTick handler
+#define TRACE_REASON_SLEEP 2 //The thread went to sleep
+#define TRACE_REASON_BLOCK 3 //The thread blocked on a mutex or another object
+
+//Causes of a wakeup
+#define TRACE_WAKE_SIGNAL 0 //Woken by osWakeThread
+#define TRACE_WAKE_SLEEP 1 //The sleep time ran out
+#define TRACE_WAKE_TIMEOUT 2 //A blocking call timed out
+#define TRACE_WAKE_MUTEX 3 //Handed a mutex it was waiting for
+
+//First word of the trace buffer, lets the host tool check it was given a trace dump
+#define TRACE_MAGIC 0x45435254
+
+//Define one trace event, 8 bytes so recording one is two stores
+typedef struct trace_event_struct
+{
+	uint32_t cycles; //DWT cycle count when the event happened
+	uint8_t type; //Event type
+	uint8_t thread; //Thread the event is about
+	uint8_t a; //First argument
+	uint8_t b; //Second argument
+}osTraceEvent;
+
+//Define the trace buffer, the host tool reads it as one block of memory so the header describes everything it needs
+typedef struct trace_buffer_struct
+{
+	uint32_t magic; //TRACE_MAGIC
+	volatile uint32_t head; //Number of events recorded so far, the newest is at (head - 1) % capacity
+	uint32_t clock; //CPU clock in Hz, to turn cycles into time
+	uint32_t capacity; //Number of events in the ring
+	uint32_t maxThreads; //Number of entries in threadFuncs
+	uint32_t threadFuncs[MAX_THREADS]; //Function of each thread, to name threads from the ELF symbols
+	osTraceEvent events[TRACE_RING_EVENTS]; //Ring of events, the oldest are overwritten
+}osTraceBuffer;
+
+#ifdef OS_TRACE
+	//Record an event, costs a critical section and two stores
+	#define osTrace(type, thread, a, b) osTraceRecord(type, thread, a, b)
+#else
+	//Tracing is compiled out, sizeof keeps the arguments counted as used without evaluating them
+	#define osTrace(type, thread, a, b) ((void)sizeof((type) + (thread) + (a) + (b)))
+#endif
+
+//Start recording, called by kernel_start once every thread has been created
+void osTraceStart(void);
+
+//Record an event, use the osTrace macro so the call disappears when OS_TRACE is not defined
+void osTraceRecord(uint32_t type, uint32_t thread, uint32_t a, uint32_t b);
+
+//Send the whole trace buffer over a UART port, for boards without a debugger to dump memory with
+void osTraceDump(uint32_t portNum);
+
+#endif
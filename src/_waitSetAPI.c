@@ -0,0 +1,190 @@
+/*----------------------------------------------------------------------------
+ * Name: _waitSetAPI.c
+ * Purpose: Stores any functions a part of the Wait Set API, used to block one thread on several objects at once
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _queueAPI, and _waitSetAPI
+#include "_kernelCore.h"
+#include "_queueAPI.h"
+#include "_waitSetAPI.h"
+
+osWaitSet osWaitSets[MAX_WAIT_SETS]; //Static wait set struct array
+int num_wait_sets = 0; //Number of created wait sets
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern osQueue osQueues[MAX_QUEUES]; //Static queue struct array
+extern int runningThread; //Current running thread index
+
+//Create an empty wait set, returns the wait set index or -1 if the wait set cannot be created
+int osCreateWaitSet(void)
+{
+	//Create the wait set if the number of wait sets is less than the maximum
+	if (num_wait_sets < MAX_WAIT_SETS)
+	{
+		osWaitSets[num_wait_sets].ID = num_wait_sets; //Set the ID of the wait set to the current index
+		osWaitSets[num_wait_sets].owner = EMPTY_INDEX; //No thread is waiting yet
+		osWaitSets[num_wait_sets].readyMask = 0; //No member has been signalled yet
+		osWaitSets[num_wait_sets].lastReady = -1; //Start looking at the first member
+		osWaitSets[num_wait_sets].numMembers = 0; //The set starts empty
+
+		num_wait_sets++; //Increment the number of wait sets
+		return num_wait_sets - 1; //Return the wait set index (position of the wait set in the array)
+	}
+	return -1; //Return -1 if the wait set cannot be created
+}
+
+//Add an object to the wait set, returns the member index or -1 if the set is full
+//Each object keeps the set and member it belongs to, so signalling a member never searches the set
+int waitSetAddMember(int wait_set_index, int type, int index)
+{
+	osWaitSet* waitSet = &osWaitSets[wait_set_index];
+
+	if (waitSet->numMembers >= MAX_WAIT_SET_MEMBERS)
+	{
+		return -1; //Return -1 if the set is full
+	}
+
+	int member = waitSet->numMembers;
+	waitSet->memberType[member] = type;
+	waitSet->memberIndex[member] = index;
+	waitSet->readyMask |= 1U << member; //Check the new member on the next wait in case it is already ready
+	waitSet->numMembers++;
+	return member;
+}
+
+//Add a lock-free queue to the wait set, returns the member index or -1 if the set is full or the queue is already in a set
+int osWaitSetAddQueue(int wait_set_index, int queue_index)
+{
+	uint32_t state = osEnterCritical();
+	int member = -1;
+
+	//An object can only signal one wait set
+	if (osQueues[queue_index].waitSet == EMPTY_INDEX)
+	{
+		member = waitSetAddMember(wait_set_index, WAIT_OBJECT_QUEUE, queue_index);
+		if (member != -1)
+		{
+			osQueues[queue_index].waitSetMember = member;
+			osQueues[queue_index].waitSet = wait_set_index;
+		}
+	}
+
+	osExitCritical(state);
+	return member;
+}
+
+//Add the notifications of a thread to the wait set, returns the member index or -1 if the set is full or they are already in a set
+int osWaitSetAddNotify(int wait_set_index, int thread_index)
+{
+	uint32_t state = osEnterCritical();
+	int member = -1;
+
+	//An object can only signal one wait set
+	if (osThreads[thread_index].notifyWaitSet == EMPTY_INDEX)
+	{
+		member = waitSetAddMember(wait_set_index, WAIT_OBJECT_NOTIFY, thread_index);
+		if (member != -1)
+		{
+			osThreads[thread_index].notifyWaitSetMember = member;
+			osThreads[thread_index].notifyWaitSet = wait_set_index;
+		}
+	}
+
+	osExitCritical(state);
+	return member;
+}
+
+//Returns whether a member object is ready right now
+bool waitSetMemberReady(osWaitSet* waitSet, int member)
+{
+	if (waitSet->memberType[member] == WAIT_OBJECT_QUEUE)
+	{
+		return osQueueCount(waitSet->memberIndex[member]) > 0;
+	}
+	return osThreads[waitSet->memberIndex[member]].notifyPending;
+}
+
+//Find a ready member among the signalled ones, returns the member index or -1 if none are ready
+//Must be called inside a critical section
+int waitSetFindReady(osWaitSet* waitSet)
+{
+	int member = waitSet->lastReady; //Start after the member returned last time so every member gets a turn
+
+	for (int i = 0; i < waitSet->numMembers; i++)
+	{
+		member++;
+		if (member >= waitSet->numMembers)
+		{
+			member = 0;
+		}
+
+		if (waitSet->readyMask & (1U << member))
+		{
+			//A signalled member stays marked while it is ready, since the caller may not empty it in one go
+			if (waitSetMemberReady(waitSet, member))
+			{
+				waitSet->lastReady = member;
+				return member;
+			}
+			waitSet->readyMask &= ~(1U << member); //The member has been emptied, forget the signal
+		}
+	}
+	return -1;
+}
+
+//Block the running thread until one of the members is ready or timeout ticks (or WAIT_FOREVER) pass
+int osWaitSetWait(int wait_set_index, int timeout)
+{
+	osWaitSet* waitSet = &osWaitSets[wait_set_index];
+	uint32_t deadline = osGetTickCount() + timeout; //Tick count at which the wait times out
+
+	while (1)
+	{
+		uint32_t state = osEnterCritical();
+		int ready = waitSetFindReady(waitSet);
+
+		//Return straight away if a member is ready or the caller does not want to wait
+		if (ready != -1 || timeout == 0)
+		{
+			osExitCritical(state);
+			return ready;
+		}
+
+		//Work out how long is left, a wakeup that turned out to be for an emptied member must not restart the timeout
+		int remaining = WAIT_FOREVER;
+		if (timeout != WAIT_FOREVER)
+		{
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if (remaining <= 0)
+			{
+				osExitCritical(state);
+				return -1; //Return -1 when the timeout has run out
+			}
+		}
+
+		//Block until a member signals the set or the timeout runs out
+		waitSet->owner = runningThread;
+		osBlockRunningThread(remaining);
+		osExitCritical(state);
+		osYield(); //Yield
+
+		waitSet->owner = EMPTY_INDEX;
+	}
+}
+
+//Called by a member object when it becomes ready, safe to call from threads and ISRs
+void osWaitSetSignal(int wait_set_index, int member)
+{
+	uint32_t state = osEnterCritical();
+
+	osWaitSets[wait_set_index].readyMask |= 1U << member; //Mark the member as signalled
+
+	//Wake the thread blocked on the set
+	if (osWaitSets[wait_set_index].owner != EMPTY_INDEX)
+	{
+		osWakeThread(osWaitSets[wait_set_index].owner);
+	}
+
+	osExitCritical(state);
+}
@@ -0,0 +1,30 @@
+/*----------------------------------------------------------------------------
+ * Name: _waitSetAPI.h
+ * Purpose: Stores any functions a part of the Wait Set API, used to block one thread on several objects at once
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _waitSetAPI
+#ifndef _waitSetAPI
+#define _waitSetAPI
+
+#include "osDefs.h"
+
+//Create an empty wait set, returns the wait set index or -1 if the wait set cannot be created
+int osCreateWaitSet(void);
+
+//Add a lock-free queue to the wait set, returns the member index or -1 if the set is full or the queue is already in a set
+int osWaitSetAddQueue(int wait_set_index, int queue_index);
+
+//Add the notifications of a thread to the wait set, returns the member index or -1 if the set is full or they are already in a set
+int osWaitSetAddNotify(int wait_set_index, int thread_index);
+
+//Block the running thread until one of the members is ready or timeout ticks (or WAIT_FOREVER) pass
+//Returns the member index of a ready object, or -1 on timeout
+//A timeout of 0 only checks whether a member is ready
+int osWaitSetWait(int wait_set_index, int timeout);
+
+//Called by a member object when it becomes ready, safe to call from threads and ISRs
+void osWaitSetSignal(int wait_set_index, int member);
+
+#endif
@@ -0,0 +1,179 @@
+/*----------------------------------------------------------------------------
+ * Name: _workQueueAPI.c
+ * Purpose: Stores any functions a part of the Work Queue API, used to defer work from ISRs to worker threads
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore, _threadsCore, _queueAPI, and _workQueueAPI
+#include "_kernelCore.h"
+#include "_threadsCore.h"
+#include "_queueAPI.h"
+#include "_workQueueAPI.h"
+
+osWorkQueue osWorkQueues[MAX_WORK_QUEUES]; //Static work queue struct array
+int num_work_queues = 0; //Number of created work queues
+
+extern rtosThread osThreads[MAX_THREADS]; //Static thread struct array
+extern int runningThread; //Current running thread index
+extern int num_queues; //Number of created lock-free queues
+
+//Create a work queue serviced by numWorkers worker threads, returns the work queue index or -1 if it cannot be created
+int osCreateWorkQueue(int numWorkers)
+{
+	//Only create the work queue if there is room for it and its two lock-free queues (pending and free items) and a valid number of workers was requested
+	if (num_work_queues >= MAX_WORK_QUEUES || numWorkers < 1 || numWorkers > MAX_WORKERS || num_queues + 2 > MAX_QUEUES)
+	{
+		return -1;
+	}
+
+	osWorkQueue* workQueue = &osWorkQueues[num_work_queues];
+
+	//Create the worker threads first, they cannot be deleted so nothing else is created unless at least one of them was
+	//The workers do not run before kernel_start, so they find their work queue once it is complete
+	workQueue->numWorkers = 0;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		int worker = create_thread(osWorkerThread);
+		if (worker != -1)
+		{
+			workQueue->workers[workQueue->numWorkers] = worker;
+			workQueue->numWorkers++;
+		}
+	}
+	if (workQueue->numWorkers == 0)
+	{
+		return -1; //Return -1 if there is no room for a single worker thread
+	}
+
+	//There is room for both lock-free queues, checked above
+	workQueue->pendingQueue = osCreateQueue();
+	workQueue->freeQueue = osCreateQueue();
+
+	//Every item starts out free
+	for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+	{
+		osQueuePut(workQueue->freeQueue, i);
+	}
+
+	workQueue->ID = num_work_queues; //Set the ID of the work queue to the current index
+	workQueue->stats = (osWorkStats){0}; //Clear the statistics
+
+	num_work_queues++; //Increment the number of work queues
+	return workQueue->ID; //Return the work queue index (position of the work queue in the array)
+}
+
+//Submit a function and argument to be run by a worker thread, returns false if the queue is full
+bool osWorkSubmit(int work_queue_index, void (*func)(void* arg), void* arg)
+{
+	osWorkQueue* workQueue = &osWorkQueues[work_queue_index];
+	uint32_t index; //Index of the item used for this piece of work
+
+	//Take a free item, if there are none the queue is full and the work is dropped
+	if (!osQueueGet(workQueue->freeQueue, &index))
+	{
+		uint32_t state = osEnterCritical();
+		workQueue->stats.dropped++;
+		osExitCritical(state);
+		return false;
+	}
+
+	//Fill in the item and hand it to the workers
+	workQueue->items[index].func = func;
+	workQueue->items[index].arg = arg;
+	workQueue->items[index].submitTime = portCycles();
+	osQueuePut(workQueue->pendingQueue, index); //Cannot fail since there are as many pending slots as items
+
+	//Update the statistics, this is only a few instructions so the ISR is not held up
+	uint32_t state = osEnterCritical();
+	workQueue->stats.submitted++;
+	uint32_t depth = osQueueCount(workQueue->pendingQueue);
+	if (depth > workQueue->stats.maxDepth)
+	{
+		workQueue->stats.maxDepth = depth;
+	}
+	osExitCritical(state);
+
+	//Wake the first blocked worker, the others stay blocked until there is more work
+	for (int i = 0; i < workQueue->numWorkers; i++)
+	{
+		if (osThreads[workQueue->workers[i]].status == BLOCKED)
+		{
+			osWakeThread(workQueue->workers[i]);
+			break;
+		}
+	}
+	return true;
+}
+
+//Copy the statistics of a work queue into stats
+void osGetWorkStats(int work_queue_index, osWorkStats* stats)
+{
+	uint32_t state = osEnterCritical();
+	*stats = osWorkQueues[work_queue_index].stats;
+	stats->depth = osQueueCount(osWorkQueues[work_queue_index].pendingQueue);
+	osExitCritical(state);
+}
+
+//Worker thread that runs the items of its work queue in order
+void osWorkerThread(void* args)
+{
+	osWorkQueue* workQueue = NULL; //Work queue serviced by this worker
+
+	//Find the work queue this thread was created for
+	for (int i = 0; i < num_work_queues && workQueue == NULL; i++)
+	{
+		for (int j = 0; j < osWorkQueues[i].numWorkers; j++)
+		{
+			if (osWorkQueues[i].workers[j] == runningThread)
+			{
+				workQueue = &osWorkQueues[i];
+			}
+		}
+	}
+
+	//A worker that was not created by osCreateWorkQueue has no queue, so it blocks forever
+	while (workQueue == NULL)
+	{
+		uint32_t state = osEnterCritical();
+		osBlockRunningThread(WAIT_FOREVER);
+		osExitCritical(state);
+		osYield(); //Yield
+	}
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		uint32_t index; //Index of the item being run
+
+		if (osQueueGet(workQueue->pendingQueue, &index))
+		{
+			osWorkItem item = workQueue->items[index]; //Copy the item so its slot can be reused straight away
+			uint32_t latency = portCycles() - item.submitTime;
+			osQueuePut(workQueue->freeQueue, index);
+
+			item.func(item.arg); //Run the deferred work
+
+			//Update the statistics
+			uint32_t state = osEnterCritical();
+			workQueue->stats.completed++;
+			workQueue->stats.totalLatency += latency;
+			if (latency > workQueue->stats.maxLatency)
+			{
+				workQueue->stats.maxLatency = latency;
+			}
+			osExitCritical(state);
+		}
+		else
+		{
+			//Block until more work is submitted
+			//The check is repeated inside the critical section so a submit from an ISR cannot slip in before the thread is blocked
+			uint32_t state = osEnterCritical();
+			if (osQueueCount(workQueue->pendingQueue) == 0)
+			{
+				osBlockRunningThread(WAIT_FOREVER);
+			}
+			osExitCritical(state);
+			osYield(); //Yield
+		}
+	}
+}
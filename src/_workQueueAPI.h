@@ -0,0 +1,27 @@
+/*----------------------------------------------------------------------------
+ * Name: _workQueueAPI.h
+ * Purpose: Stores any functions a part of the Work Queue API, used to defer work from ISRs to worker threads
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for _workQueueAPI
+#ifndef _workQueueAPI
+#define _workQueueAPI
+
+#include "osDefs.h"
+
+//Create a work queue serviced by numWorkers worker threads, returns the work queue index or -1 if it cannot be created
+//Must be called before kernel_start since it creates threads
+int osCreateWorkQueue(int numWorkers);
+
+//Submit a function and argument to be run by a worker thread, returns false if the queue is full
+//Safe to call from any thread or ISR, the ISR only pays for a lock-free put
+bool osWorkSubmit(int work_queue_index, void (*func)(void* arg), void* arg);
+
+//Copy the statistics of a work queue into stats
+void osGetWorkStats(int work_queue_index, osWorkStats* stats);
+
+//Worker thread that runs the items of its work queue in order
+void osWorkerThread(void* args);
+
+#endif
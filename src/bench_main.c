@@ -0,0 +1,467 @@
+/*----------------------------------------------------------------------------
+ * Name: bench_main.c
+ * Purpose: Kernel benchmark suite, build it instead of p1_main.c to measure the kernel in CPU cycles
+ *----------------------------------------------------------------------------
+*/
+
+//Each test collects BENCH_SAMPLES measurements and prints one CSV row of min, avg, percentiles and max in cycles
+//Times come from the DWT cycle counter, if it does not count (QEMU does not model the DWT) they come from SysTick instead
+//The tests only use two threads so the idle thread never runs while something is being measured
+
+//This file is for printf and other IO functions
+#include "stdio.h"
+
+//This file is for qsort
+#include <stdlib.h>
+
+//This file is for the printf formats of the fixed width integers (PRIu32)
+#include "inttypes.h"
+
+//Include header file for _threadsCore
+#include "_threadsCore.h"
+
+//Include header file for _kernelCore
+#include "_kernelCore.h"
+
+//Include header file for _mutexAPI
+#include "_mutexAPI.h"
+
+//Include header file for _cpuAPI
+#include "_cpuAPI.h"
+
+//Define the number of samples per test, the tests that wait for a tick take fewer so the suite finishes in a few seconds
+#define BENCH_SAMPLES 1000
+#define BENCH_TICK_SAMPLES 200
+
+//Define the interrupt used by the ISR to thread test, any interrupt nothing else uses will do
+//A board port can override these with its own unused interrupt, the device header comes in through osDefs.h
+#ifndef BENCH_IRQn
+	#define BENCH_IRQn RIT_IRQn
+	#define BENCH_IRQHandler RIT_IRQHandler
+#endif
+
+//Define the benchmark phases, thread A runs every test and moves the suite on, thread B only joins the tests that need a second thread
+#define BENCH_PARK 0 //Thread B blocks until the next test needs it
+#define BENCH_YIELD 1 //Both threads yield to each other
+#define BENCH_PREEMPT 2 //Both threads spin until the timeslice runs out
+#define BENCH_MUTEX_CONTENDED 3 //Thread B holds the mutex thread A wants
+#define BENCH_WAKE 4 //Thread B wakes thread A with osWakeThread
+#define BENCH_SLEEP 5 //Thread B yields in a loop while thread A sleeps
+#define BENCH_ISR 6 //Thread B pends the interrupt that wakes thread A
+
+//Define the threads and the mutex
+int benchA;
+int benchB;
+int benchMutex;
+
+volatile int benchPhase = BENCH_PARK; //Test thread B should join
+volatile int benchParked = EMPTY_INDEX; //Thread B while it is parked (EMPTY_INDEX while it runs)
+volatile int benchWaiter = EMPTY_INDEX; //Thread A while it is blocked waiting to be woken (EMPTY_INDEX while it runs)
+volatile bool benchArmed = false; //Whether benchStamp holds a start time for the next sample
+volatile bool benchHeld = false; //Whether thread B holds the mutex in the contended test
+volatile int benchOwner = EMPTY_INDEX; //Thread that took the last timestamp in the preemption test
+volatile uint32_t benchStamp = 0; //Start time of the sample in progress
+
+bool benchUseDWT = false; //Whether the DWT cycle counter is used as the time base
+uint32_t benchOverhead = 0; //Cycles taken by two back to back benchNow calls, taken off every sample
+
+uint32_t benchSamples[BENCH_SAMPLES]; //Samples of the test in progress
+volatile int benchCount = 0; //Number of samples taken
+int benchLimit = 0; //Number of samples the test in progress takes, later samples are dropped
+
+//Returns the time since the kernel started in cycles from SysTick, counts down from LOAD once per tick
+//Wraps every 2^32 cycles like the DWT counter, so differences of two readings are still right
+uint32_t benchSysTickNow(void)
+{
+	uint32_t ticks;
+	uint32_t value;
+
+	//Read again if a tick was counted part way through
+	do
+	{
+		ticks = osGetTickCount();
+		value = SysTick->VAL;
+
+		//With interrupts masked the counter can reload before the handler counts the tick
+		//Bit 26 of ICSR is set while the SysTick interrupt is pending
+		if ((ICSR & (1 << 26)) && value > SysTick->LOAD / 2)
+		{
+			ticks++;
+		}
+	} while (ticks != osGetTickCount());
+
+	return ticks * (SysTick->LOAD + 1) + (SysTick->LOAD - value);
+}
+
+//Returns the current time in cycles
+uint32_t benchNow(void)
+{
+	if (benchUseDWT)
+	{
+		return DWT->CYCCNT;
+	}
+	return benchSysTickNow();
+}
+
+//Store one sample, takes off the timing overhead
+void benchRecord(uint32_t cycles)
+{
+	if (benchCount < benchLimit)
+	{
+		benchSamples[benchCount++] = cycles > benchOverhead ? cycles - benchOverhead : 0;
+	}
+}
+
+//Compare function for qsort
+int benchCompare(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+//Print the CSV row of the test that just finished and empty the samples
+void benchReport(const char* name)
+{
+	uint64_t total = 0;
+	int n = benchCount;
+
+	qsort(benchSamples, n, sizeof(uint32_t), benchCompare);
+	for (int i = 0; i < n; i++)
+	{
+		total += benchSamples[i];
+	}
+
+	printf("%s,%d,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", name, n, benchSamples[0], (uint32_t)(total / n),
+		benchSamples[n / 2], benchSamples[n * 90 / 100], benchSamples[n * 99 / 100], benchSamples[n - 1]);
+
+	benchCount = 0;
+}
+
+//Start a test that takes limit samples, wakes thread B if the test needs it
+void benchStart(int phase, int limit)
+{
+	uint32_t state = osEnterCritical();
+
+	benchCount = 0;
+	benchLimit = limit;
+	benchArmed = false;
+	benchPhase = phase;
+	if (benchParked != EMPTY_INDEX)
+	{
+		osWakeThread(benchParked);
+		benchParked = EMPTY_INDEX;
+	}
+
+	osExitCritical(state);
+}
+
+//End a test, waits for thread B to park so it cannot disturb the report
+void benchStop(void)
+{
+	benchPhase = BENCH_PARK;
+	while (benchParked == EMPTY_INDEX)
+	{
+		osYield(); //Let thread B see the new phase
+	}
+}
+
+//Block thread B until a test needs it, the phase is checked inside the critical section so a wakeup is never missed
+void benchPark(void)
+{
+	uint32_t state = osEnterCritical();
+
+	if (benchPhase == BENCH_PARK)
+	{
+		benchParked = osGetRunningThread();
+		osBlockRunningThread(WAIT_FOREVER);
+	}
+
+	osExitCritical(state);
+	osYield(); //Yield
+}
+
+//Block thread A until thread B or the interrupt wakes it
+void benchWait(void)
+{
+	uint32_t state = osEnterCritical();
+	benchWaiter = osGetRunningThread();
+	osBlockRunningThread(WAIT_FOREVER);
+	osExitCritical(state);
+	osYield(); //Yield
+}
+
+//Yield test step, the thread that resumes measures from the timestamp the other thread took just before it yielded
+void benchYieldStep(void)
+{
+	uint32_t now = benchNow();
+	if (benchArmed)
+	{
+		benchRecord(now - benchStamp);
+	}
+	benchStamp = benchNow();
+	benchArmed = true;
+	osYield(); //Yield
+}
+
+//Preemption test step, neither thread yields so only the end of a timeslice moves the CPU to the other one
+//The first timestamp a thread takes after getting the CPU back is measured from the last one the other thread took
+void benchPreemptStep(void)
+{
+	uint32_t now = benchNow();
+	int self = osGetRunningThread();
+
+	if (benchOwner != self)
+	{
+		if (benchOwner != EMPTY_INDEX)
+		{
+			benchRecord(now - benchStamp);
+		}
+		benchOwner = self;
+	}
+	benchStamp = now;
+}
+
+//Thread B side of the contended mutex test, takes the mutex, lets thread A block on it, then hands it over
+void benchHolderStep(void)
+{
+	if (!benchHeld && osAcquireMutex(benchB, benchMutex))
+	{
+		benchHeld = true;
+		osYield(); //Thread A tries for the mutex, blocks and yields back
+
+		benchStamp = benchNow();
+		osReleaseMutex(benchB, benchMutex); //Hands the mutex to thread A
+	}
+	osYield(); //Yield
+}
+
+//Thread B side of the wake test, wakes thread A as soon as it has blocked
+void benchWakerStep(void)
+{
+	if (benchWaiter != EMPTY_INDEX)
+	{
+		int waiter = benchWaiter;
+		benchWaiter = EMPTY_INDEX;
+		benchStamp = benchNow();
+		osWakeThread(waiter);
+	}
+	osYield(); //Yield
+}
+
+//Thread B side of the ISR test, pends the interrupt that wakes thread A
+void benchTriggerStep(void)
+{
+	if (benchWaiter != EMPTY_INDEX)
+	{
+		NVIC_SetPendingIRQ(BENCH_IRQn);
+	}
+	osYield(); //Yield
+}
+
+//Interrupt of the ISR test, wakes thread A, the sample runs from the first instruction of the handler to thread A running
+void BENCH_IRQHandler(void)
+{
+	uint32_t now = benchNow();
+
+	osISREnter(); //Time in the handler is not charged to the running thread
+
+	if (benchWaiter != EMPTY_INDEX)
+	{
+		benchStamp = now;
+		osWakeThread(benchWaiter);
+		benchWaiter = EMPTY_INDEX;
+	}
+
+	osISRExit();
+}
+
+//Thread A runs the suite
+void benchThreadA(void* args)
+{
+	//Measure the cost of reading the time so it can be taken off every sample
+	benchOverhead = 0xFFFFFFFF;
+	for (int i = 0; i < 100; i++)
+	{
+		uint32_t start = benchNow();
+		uint32_t end = benchNow();
+		if (end - start < benchOverhead)
+		{
+			benchOverhead = end - start;
+		}
+	}
+
+	printf("# kernel benchmark, clock %" PRIu32 " Hz, time base %s, overhead %" PRIu32 " cycles\n", SystemCoreClock, benchUseDWT ? "DWT" : "SysTick", benchOverhead);
+	printf("test,samples,min,avg,p50,p90,p99,max\n");
+
+	//Yield to yield switch time
+	benchStart(BENCH_YIELD, BENCH_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		benchYieldStep();
+	}
+	benchStop();
+	benchReport("yield");
+
+	//Preemption when the timeslice runs out in the SysTick handler
+	benchOwner = EMPTY_INDEX;
+	benchStart(BENCH_PREEMPT, BENCH_TICK_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		benchPreemptStep();
+	}
+	benchStop();
+	benchReport("preempt");
+
+	//Uncontended mutex, acquire and release are timed in separate passes with thread B parked
+	benchStart(BENCH_PARK, BENCH_SAMPLES);
+	for (int i = 0; i < BENCH_SAMPLES; i++)
+	{
+		uint32_t start = benchNow();
+		osAcquireMutex(benchA, benchMutex);
+		benchRecord(benchNow() - start);
+		osReleaseMutex(benchA, benchMutex);
+	}
+	benchReport("mutex_acquire");
+
+	benchStart(BENCH_PARK, BENCH_SAMPLES);
+	for (int i = 0; i < BENCH_SAMPLES; i++)
+	{
+		osAcquireMutex(benchA, benchMutex);
+		uint32_t start = benchNow();
+		osReleaseMutex(benchA, benchMutex);
+		benchRecord(benchNow() - start);
+	}
+	benchReport("mutex_release");
+
+	//Contended mutex, from thread B releasing to thread A running with the mutex
+	benchHeld = false;
+	benchStart(BENCH_MUTEX_CONTENDED, BENCH_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		//Wait for thread B to take the mutex
+		while (!benchHeld)
+		{
+			osYield(); //Yield
+		}
+
+		//Block on the mutex, thread B hands it over while thread A is blocked
+		if (!osAcquireMutex(benchA, benchMutex))
+		{
+			osYield(); //Yield
+		}
+		benchRecord(benchNow() - benchStamp);
+
+		benchHeld = false;
+		osReleaseMutex(benchA, benchMutex);
+	}
+	benchStop();
+	benchReport("mutex_contended");
+
+	//Wakeup by another thread, from osWakeThread to thread A running
+	benchStart(BENCH_WAKE, BENCH_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		benchWait();
+		benchRecord(benchNow() - benchStamp);
+	}
+	benchStop();
+	benchReport("wake");
+
+	//Sleep, from the tick that ends the sleep to thread A running, the tick time is read back from SysTick
+	benchStart(BENCH_SLEEP, BENCH_TICK_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		uint32_t wakeTick = osGetTickCount() + 1; //A one tick sleep ends on the next tick
+		osSleep(1);
+		benchRecord(benchSysTickNow() - wakeTick * (SysTick->LOAD + 1));
+	}
+	benchStop();
+	benchReport("sleep");
+
+	//Interrupt to thread, from the first instruction of the handler to thread A running
+	NVIC_EnableIRQ(BENCH_IRQn);
+	benchStart(BENCH_ISR, BENCH_SAMPLES);
+	while (benchCount < benchLimit)
+	{
+		benchWait();
+		benchRecord(benchNow() - benchStamp);
+	}
+	benchStop();
+	NVIC_DisableIRQ(BENCH_IRQn);
+	benchReport("isr_to_thread");
+
+	printf("# done\n");
+
+	//A headless run (the QEMU board port) ends the program here so the next run can start
+#ifdef BENCH_EXIT
+	exit(0);
+#endif
+
+	//The suite only runs once
+	while (1)
+	{
+		benchWait();
+	}
+}
+
+//Thread B joins whichever test needs it and parks otherwise
+void benchThreadB(void* args)
+{
+	//Infinite loop for the thread
+	while (1)
+	{
+		switch (benchPhase)
+		{
+			case BENCH_YIELD:
+				benchYieldStep();
+				break;
+			case BENCH_PREEMPT:
+				benchPreemptStep();
+				break;
+			case BENCH_MUTEX_CONTENDED:
+				benchHolderStep();
+				break;
+			case BENCH_WAKE:
+				benchWakerStep();
+				break;
+			case BENCH_SLEEP:
+				osYield(); //Keep the CPU busy so the idle thread does not hold it until its timeslice ends
+				break;
+			case BENCH_ISR:
+				benchTriggerStep();
+				break;
+			default:
+				benchPark();
+				break;
+		}
+	}
+}
+
+//This is C. The expected function heading is int main(void)
+int main(void)
+{
+	//Always call this function at the start. It sets up various peripherals, the clock etc.
+	SystemInit();
+
+	//Call kernelInit before creating threads, it also starts the DWT cycle counter
+	kernelInit();
+
+	//Use the DWT cycle counter if it is counting, otherwise fall back to SysTick
+	uint32_t start = DWT->CYCCNT;
+	for (volatile int i = 0; i < 100; i++);
+	benchUseDWT = DWT->CYCCNT != start;
+
+	//Setup threads, the logger thread is left out since it would run in the middle of the tests
+	benchA = create_thread(benchThreadA);
+	benchB = create_thread(benchThreadB);
+
+	//Setup the mutex
+	benchMutex = osCreateMutex();
+
+	//Start the kernel
+	kernel_start();
+
+	//Your code should always terminate in an endless loop if it is done
+	while(1);
+}
@@ -0,0 +1,43 @@
+/*----------------------------------------------------------------------------
+ * Name: gpio.c
+ * Purpose: GPIO pin groups written with one masked FIOPIN store per port
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for gpio and _kernelCore
+#include "gpio.h"
+#include "_kernelCore.h"
+
+//Make every pin of the group an output
+void GPIOGroupInit(const gpioGroup* group)
+{
+	uint32_t state = osEnterCritical();
+
+	for (int i = 0; i < GPIO_GROUP_PORTS; i++)
+	{
+		group->port[i]->FIODIR |= group->mask[i];
+	}
+
+	osExitCritical(state);
+}
+
+//Drive the group to value with one masked FIOPIN store per port
+void GPIOGroupWrite(const gpioGroup* group, uint32_t value)
+{
+	value &= (1 << GPIO_GROUP_BITS) - 1;
+
+	//FIOMASK is shared by everything that writes the port, so it is only changed with interrupts off
+	uint32_t state = osEnterCritical();
+
+	for (int i = 0; i < GPIO_GROUP_PORTS; i++)
+	{
+		LPC_GPIO_TypeDef* gpio = group->port[i];
+		uint32_t mask = gpio->FIOMASK;
+
+		gpio->FIOMASK = ~group->mask[i]; //Only the group's pins take the FIOPIN write
+		gpio->FIOPIN = group->scatter[i][value]; //Set and clear every pin of the group at once
+		gpio->FIOMASK = mask;
+	}
+
+	osExitCritical(state);
+}
@@ -0,0 +1,70 @@
+/*----------------------------------------------------------------------------
+ * Name: gpio.h
+ * Purpose: GPIO pin groups written with one masked FIOPIN store per port
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for gpio
+#ifndef _gpio
+#define _gpio
+
+#include <LPC17xx.h>
+#include "osDefs.h"
+
+//A group has up to 8 bits spread over up to 2 GPIO ports
+#define GPIO_GROUP_BITS 8
+#define GPIO_GROUP_PORTS 2
+
+//Pin number that marks a group bit as not being on a port
+#define GPIO_NO_PIN 32
+
+//Port bit driven by one group bit of value, or 0 if that bit is not on the port
+#define GPIO_PIN_BIT(value, bit, pin) (((((value) >> (bit)) & 1) && (pin) < 32) ? (1UL << ((pin) & 31)) : 0UL)
+
+//Port bits driven by a whole group value, p0 to p7 are the pins of group bits 0 to 7 on the port
+#define GPIO_SCATTER(value, p0, p1, p2, p3, p4, p5, p6, p7) \
+	(GPIO_PIN_BIT(value, 0, p0) | GPIO_PIN_BIT(value, 1, p1) | GPIO_PIN_BIT(value, 2, p2) | GPIO_PIN_BIT(value, 3, p3) | \
+	 GPIO_PIN_BIT(value, 4, p4) | GPIO_PIN_BIT(value, 5, p5) | GPIO_PIN_BIT(value, 6, p6) | GPIO_PIN_BIT(value, 7, p7))
+
+//Scatter table entries for 4, 16, and all 256 group values, worked out by the compiler
+#define GPIO_SCATTER_4(value, p0, p1, p2, p3, p4, p5, p6, p7) \
+	GPIO_SCATTER((value) + 0, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER((value) + 1, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER((value) + 2, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER((value) + 3, p0, p1, p2, p3, p4, p5, p6, p7)
+#define GPIO_SCATTER_16(value, p0, p1, p2, p3, p4, p5, p6, p7) \
+	GPIO_SCATTER_4((value) + 0, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_4((value) + 4, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_4((value) + 8, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_4((value) + 12, p0, p1, p2, p3, p4, p5, p6, p7)
+#define GPIO_SCATTER_256(p0, p1, p2, p3, p4, p5, p6, p7) \
+	GPIO_SCATTER_16(0, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(16, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(32, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(48, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(64, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(80, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(96, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(112, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(128, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(144, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(160, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(176, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(192, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(208, p0, p1, p2, p3, p4, p5, p6, p7), \
+	GPIO_SCATTER_16(224, p0, p1, p2, p3, p4, p5, p6, p7), GPIO_SCATTER_16(240, p0, p1, p2, p3, p4, p5, p6, p7)
+
+//Define a pin group, gpioA and gpioB are the two ports, a0 to a7 and b0 to b7 the pins of each group bit on them
+//Use GPIO_NO_PIN where a bit is on the other port, and the same port twice (with GPIO_NO_PIN for all b) for a single port group
+#define GPIO_GROUP(gpioA, gpioB, a0, a1, a2, a3, a4, a5, a6, a7, b0, b1, b2, b3, b4, b5, b6, b7) \
+	{ \
+		{gpioA, gpioB}, \
+		{GPIO_SCATTER(0xFF, a0, a1, a2, a3, a4, a5, a6, a7), GPIO_SCATTER(0xFF, b0, b1, b2, b3, b4, b5, b6, b7)}, \
+		{{GPIO_SCATTER_256(a0, a1, a2, a3, a4, a5, a6, a7)}, {GPIO_SCATTER_256(b0, b1, b2, b3, b4, b5, b6, b7)}} \
+	}
+
+//Define a pin group descriptor, declare these const so the tables stay in flash
+typedef struct gpio_group_struct
+{
+	LPC_GPIO_TypeDef* port[GPIO_GROUP_PORTS]; //GPIO ports the group is spread over
+	uint32_t mask[GPIO_GROUP_PORTS]; //Pins of the group on each port
+	uint32_t scatter[GPIO_GROUP_PORTS][1 << GPIO_GROUP_BITS]; //FIOPIN value of each port for every group value
+}gpioGroup;
+
+//Make every pin of the group an output
+void GPIOGroupInit(const gpioGroup* group);
+
+//Drive the group to value with one masked FIOPIN store per port, pins outside the group are left alone
+//Safe to call from any thread or ISR without a lock, the stores happen back to back with interrupts off
+void GPIOGroupWrite(const gpioGroup* group, uint32_t value);
+
+#endif
@@ -0,0 +1,334 @@
+/*----------------------------------------------------------------------------
+ * Name: irq_latency_main.c
+ * Purpose: Interrupt latency harness, build it instead of p1_main.c to measure how long the kernel holds off a peripheral interrupt
+ *----------------------------------------------------------------------------
+*/
+
+//TIMER1 runs from its reset PCLK and interrupts when it reaches MR0, the handler moves MR0 on by one period each time
+//The first thing the handler does is read the counter, the count minus the match value times the PCLK divider is the number of cycles from the match to the handler running
+//PCLKSEL is left alone since writes to it after PLL0 is connected may not take effect, so the latencies have the resolution of one timer count (4 cycles at reset)
+//Those latencies go into a histogram while load threads keep the kernel busy with one kind of work per phase:
+//	idle		the load threads sleep, only the idle thread and SysTick run
+//	yield		the load threads yield to each other as fast as they can (SVC, osSched, and PendSV back to back)
+//	mutex		the load threads fight over one mutex, blocking and handing it over (mutex storm)
+//	print		the load threads printf as fast as the UART takes it
+//	mixed		each load thread does a different one of the above
+//After each phase the controller thread prints one CSV row of the distribution and the non-empty histogram buckets
+//Kernel critical sections mask every interrupt with PRIMASK, so the max of each phase is the longest one that phase hit
+
+//This file is for printf and other IO functions
+#include "stdio.h"
+
+//This file is for the PRIu32 format of uint32_t
+#include "inttypes.h"
+
+//Include header file for _threadsCore
+#include "_threadsCore.h"
+
+//Include header file for _kernelCore
+#include "_kernelCore.h"
+
+//Include header file for _mutexAPI
+#include "_mutexAPI.h"
+
+//Define the rate of the timer interrupt (10kHz)
+#ifndef IRQLAT_RATE
+	#define IRQLAT_RATE 10000
+#endif
+
+//Define the priority of the timer interrupt, 0 is the strongest, above PendSV (0xFE) and SysTick (0xFF) like most peripheral interrupts
+#ifndef IRQLAT_PRIORITY
+	#define IRQLAT_PRIORITY 0
+#endif
+
+//Define how long each load phase runs for (2s)
+#ifndef IRQLAT_PHASE_MS
+	#define IRQLAT_PHASE_MS 2000
+#endif
+
+//Define the number of load threads, the controller and idle thread are on top of these
+#ifndef IRQLAT_LOAD_THREADS
+	#define IRQLAT_LOAD_THREADS 4
+#endif
+
+//Define the histogram, IRQLAT_BUCKETS buckets of IRQLAT_BUCKET_CYCLES cycles each, the last one also counts every longer latency
+#define IRQLAT_BUCKET_CYCLES 4
+#define IRQLAT_BUCKETS 256
+
+//Define the load phases
+#define LOAD_PARK 0 //Between phases, the load threads sleep while the controller prints
+#define LOAD_IDLE 1
+#define LOAD_YIELD 2
+#define LOAD_MUTEX 3
+#define LOAD_PRINT 4
+#define LOAD_MIXED 5
+#define LOAD_PHASES 6
+
+//Names of the phases for the report
+const char* const loadNames[LOAD_PHASES] = {"park", "idle", "yield", "mutex", "print", "mixed"};
+
+//Define the threads and the mutex
+int controller;
+int loadThreads[IRQLAT_LOAD_THREADS];
+int loadMutex;
+
+volatile int loadPhase = LOAD_PARK; //Work the load threads are doing
+volatile uint32_t loadCounter = 0; //Counter the mutex load changes under the mutex
+
+//Histogram, filled by the timer interrupt
+volatile uint32_t latencyBuckets[IRQLAT_BUCKETS];
+volatile uint32_t latencyCount = 0; //Number of interrupts measured
+volatile uint32_t latencyMin = 0xFFFFFFFF; //Shortest latency in cycles
+volatile uint32_t latencyMax = 0; //Longest latency in cycles
+volatile uint64_t latencyTotal = 0; //Sum of the latencies in cycles
+volatile uint32_t latencyOverruns = 0; //Interrupts that ran a whole period or more late, so at least one match was missed
+
+//Copy of the histogram the controller reports from
+uint32_t reportBuckets[IRQLAT_BUCKETS];
+
+uint32_t latencyPeriod; //Timer counts between interrupts
+uint32_t latencyScale; //CPU cycles per timer count, the PCLK divider of TIMER1
+
+extern uint32_t getPclk(uint32_t clk_slct); //PCLK produced by a PCLKSEL code, in uart.c
+
+//TIMER1 interrupt, measures its own latency
+void TIMER1_IRQHandler(void)
+{
+	//Read the counter first, every count since the match is latency
+	uint32_t now = LPC_TIM1->TC;
+	uint32_t match = LPC_TIM1->MR0;
+	uint32_t counts = now - match;
+
+	LPC_TIM1->IR = 1; //Clear the MR0 interrupt
+
+	//Schedule the next match one period after this one, so the handler's own delay does not push the next one back
+	//A handler that was a whole period late has already missed that match, it starts again from now instead
+	if (counts < latencyPeriod)
+	{
+		LPC_TIM1->MR0 = match + latencyPeriod;
+	}
+	else
+	{
+		LPC_TIM1->MR0 = now + latencyPeriod;
+		latencyOverruns++;
+	}
+
+	uint32_t latency = counts * latencyScale; //Convert to CPU cycles
+
+	uint32_t bucket = latency / IRQLAT_BUCKET_CYCLES;
+	if (bucket >= IRQLAT_BUCKETS)
+	{
+		bucket = IRQLAT_BUCKETS - 1;
+	}
+	latencyBuckets[bucket]++;
+	latencyCount++;
+	latencyTotal += latency;
+	if (latency < latencyMin)
+	{
+		latencyMin = latency;
+	}
+	if (latency > latencyMax)
+	{
+		latencyMax = latency;
+	}
+}
+
+//Start TIMER1 so it interrupts at IRQLAT_RATE
+void latencyTimerInit(void)
+{
+	//TIMER1 keeps the PCLK bits 4~5 of PCLKSEL0 select, the readings are scaled by its divider instead
+	uint32_t pclk = getPclk(LPC_SC->PCLKSEL0 >> 4);
+	latencyScale = SystemCoreClock / pclk;
+	latencyPeriod = pclk / IRQLAT_RATE;
+
+	LPC_TIM1->TCR = 2; //Hold the counter in reset while it is set up
+	LPC_TIM1->PR = 0;
+	LPC_TIM1->MR0 = latencyPeriod;
+	LPC_TIM1->MCR = 1; //Interrupt on MR0 and keep counting, the handler moves MR0 on
+	LPC_TIM1->IR = 1;
+
+	NVIC_SetPriority(TIMER1_IRQn, IRQLAT_PRIORITY);
+	NVIC_EnableIRQ(TIMER1_IRQn);
+	LPC_TIM1->TCR = 1; //Start the timer
+}
+
+//Empty the histogram for the next phase
+void latencyReset(void)
+{
+	uint32_t state = osEnterCritical();
+	for (int i = 0; i < IRQLAT_BUCKETS; i++)
+	{
+		latencyBuckets[i] = 0;
+	}
+	latencyCount = 0;
+	latencyMin = 0xFFFFFFFF;
+	latencyMax = 0;
+	latencyTotal = 0;
+	latencyOverruns = 0;
+	osExitCritical(state);
+}
+
+//Returns the latency in cycles that permille thousandths of the interrupts stayed under, the top of the bucket it is in
+uint32_t latencyPercentile(uint32_t count, uint32_t permille, uint32_t max)
+{
+	uint64_t needed = ((uint64_t)count * permille + 999) / 1000;
+	uint64_t counted = 0;
+
+	for (int i = 0; i < IRQLAT_BUCKETS - 1; i++)
+	{
+		counted += reportBuckets[i];
+		if (counted >= needed)
+		{
+			uint32_t top = (i + 1) * IRQLAT_BUCKET_CYCLES - 1;
+			return (top < max) ? top : max;
+		}
+	}
+	return max;
+}
+
+//Print the CSV row and the histogram of the phase that just finished
+void latencyReport(int phase)
+{
+	//Copy everything at once, the interrupt keeps counting while the report prints
+	uint32_t state = osEnterCritical();
+	for (int i = 0; i < IRQLAT_BUCKETS; i++)
+	{
+		reportBuckets[i] = latencyBuckets[i];
+	}
+	uint32_t count = latencyCount;
+	uint32_t min = latencyMin;
+	uint32_t max = latencyMax;
+	uint64_t total = latencyTotal;
+	uint32_t overruns = latencyOverruns;
+	osExitCritical(state);
+
+	if (count == 0)
+	{
+		printf("%s,0,,,,,,,%" PRIu32 "\n", loadNames[phase], overruns);
+		return;
+	}
+
+	printf("%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", loadNames[phase], count, min, (uint32_t)(total / count),
+		latencyPercentile(count, 500, max), latencyPercentile(count, 990, max), latencyPercentile(count, 999, max), max, overruns);
+
+	//Histogram as bucket start:count pairs, only the buckets that were hit
+	printf("# %s buckets", loadNames[phase]);
+	for (int i = 0; i < IRQLAT_BUCKETS; i++)
+	{
+		if (reportBuckets[i] != 0)
+		{
+			printf(" %d:%" PRIu32, i * IRQLAT_BUCKET_CYCLES, reportBuckets[i]);
+		}
+	}
+	printf("\n");
+}
+
+//Yield load, one round
+void loadYield(void)
+{
+	osYield(); //Yield
+}
+
+//Mutex load, one round, take the mutex, change the counter, and let it go straight to the next waiter
+void loadMutexRound(int self)
+{
+	//Block until the mutex is handed over if another thread has it
+	if (!osAcquireMutex(self, loadMutex))
+	{
+		osYield(); //Yield
+	}
+	loadCounter++;
+	osReleaseMutex(self, loadMutex);
+	osYield(); //Yield so the waiters storm the mutex again straight away
+}
+
+//Print load, one round
+void loadPrint(int self)
+{
+	printf("load thread %d printing to keep the UART and its interrupt busy %" PRIu32 "\n", self, osGetTickCount());
+}
+
+//Load thread, does whatever the phase asks for
+void loadThread(void* args)
+{
+	int self = osGetRunningThread();
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		int phase = loadPhase;
+
+		//The mixed phase gives each thread its own load
+		if (phase == LOAD_MIXED)
+		{
+			phase = LOAD_YIELD + self % 3;
+		}
+
+		switch (phase)
+		{
+			case LOAD_YIELD:
+				loadYield();
+				break;
+			case LOAD_MUTEX:
+				loadMutexRound(self);
+				break;
+			case LOAD_PRINT:
+				loadPrint(self);
+				break;
+			default:
+				osSleep(10); //Park or idle, wake up now and then to look at the phase
+				break;
+		}
+	}
+}
+
+//Controller thread, runs each phase and reports it
+void controllerThread(void* args)
+{
+	printf("# interrupt latency in cycles, clock %" PRIu32 " Hz, timer at %d Hz with priority %d, %" PRIu32 " cycles per count, %d load threads, %d ms per phase\n",
+		SystemCoreClock, IRQLAT_RATE, IRQLAT_PRIORITY, latencyScale, IRQLAT_LOAD_THREADS, IRQLAT_PHASE_MS);
+	printf("load,samples,min,avg,p50,p99,p99.9,max,overruns\n");
+
+	//Infinite loop for the thread, the phases repeat so a long run catches rarer worst cases
+	while (1)
+	{
+		for (int phase = LOAD_IDLE; phase < LOAD_PHASES; phase++)
+		{
+			latencyReset();
+			loadPhase = phase;
+			osSleep(IRQLAT_PHASE_MS);
+
+			//Stop the load before printing so the report does not fight the print load for the UART
+			loadPhase = LOAD_PARK;
+			latencyReport(phase);
+			osSleep(20); //Let the load threads see the park and the report drain
+		}
+	}
+}
+
+//This is C. The expected function heading is int main(void)
+int main(void)
+{
+	//Always call this function at the start. It sets up various peripherals, the clock etc.
+	SystemInit();
+
+	kernelInit();
+
+	//Setup the mutex
+	loadMutex = osCreateMutex();
+
+	//Setup threads, the controller first so it gets the CPU as soon as its sleep ends
+	controller = create_thread(controllerThread);
+	for (int i = 0; i < IRQLAT_LOAD_THREADS; i++)
+	{
+		loadThreads[i] = create_thread(loadThread);
+	}
+
+	latencyTimerInit();
+
+	//Start the kernel
+	kernel_start();
+
+	//Your code should always terminate in an endless loop if it is done
+	while(1);
+}
@@ -0,0 +1,143 @@
+/*----------------------------------------------------------------------------
+ * Name: itm.c
+ * Purpose: ITM stimulus port output with one port per thread, written a 32-bit word at a time
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for LPC17xx, itm, and _kernelCore
+#include <LPC17xx.h>
+#include "itm.h"
+#include "_kernelCore.h"
+
+//Characters waiting to be written on each port, only the owner of a port touches its entry
+uint32_t itmPendingWord[ITM_NUM_PORTS]; //Characters packed low byte first
+uint32_t itmPendingCount[ITM_NUM_PORTS]; //Number of characters in the word
+
+//Enable the stimulus ports used by the port map, does nothing unless the debugger has turned the ITM on
+void ITMInit(void)
+{
+	if (!(ITM->TCR & ITM_TCR_ITMENA_Msk))
+	{
+		return; //No debugger is collecting the trace
+	}
+
+	ITM->LAR = 0xC5ACCE55; //Unlock the ITM registers
+	ITM->TER = 0xFFFFFFFF; //Enable every port, the host picks the ones it wants
+}
+
+//Returns the stimulus port of the caller
+uint32_t ITMCallerPort(void)
+{
+	if (__get_IPSR() != 0)
+	{
+		return ITM_ISR_PORT;
+	}
+	if (!osCanBlock())
+	{
+		return ITM_MAIN_PORT;
+	}
+
+	//Threads past the last port of their own share one, so a large MAX_THREADS cannot reach the subsystem or ISR ports
+	uint32_t thread = osGetRunningThread();
+	if (thread >= ITM_SHARED_THREAD_PORT - ITM_THREAD_PORT_BASE)
+	{
+		return ITM_SHARED_THREAD_PORT;
+	}
+	return ITM_THREAD_PORT_BASE + thread;
+}
+
+//Write one 32-bit word to a stimulus port, waiting while the port's FIFO is full
+void ITMWriteWord(uint32_t port, uint32_t word)
+{
+	//Writes to a disabled or missing port are dropped, and waiting on one would never end
+	if (port >= ITM_NUM_PORTS || !(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1U << port)))
+	{
+		return;
+	}
+
+	while (ITM->PORT[port].u32 == 0); //Reading the port returns 0 while its FIFO is full
+	ITM->PORT[port].u32 = word; //One write sends all four bytes
+}
+
+//Write a block of bytes to a stimulus port as 32-bit words, with 16 and 8-bit writes for the last bytes
+void ITMWrite(uint32_t port, const uint8_t* data, uint32_t length)
+{
+	if (port >= ITM_NUM_PORTS || !(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1U << port)))
+	{
+		return;
+	}
+
+	//The SWO packet header carries the write size, so the host knows how many bytes each write holds
+	while (length >= 4)
+	{
+		while (ITM->PORT[port].u32 == 0);
+		ITM->PORT[port].u32 = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		data += 4;
+		length -= 4;
+	}
+	if (length >= 2)
+	{
+		while (ITM->PORT[port].u32 == 0);
+		ITM->PORT[port].u16 = data[0] | (data[1] << 8);
+		data += 2;
+		length -= 2;
+	}
+	if (length == 1)
+	{
+		while (ITM->PORT[port].u32 == 0);
+		ITM->PORT[port].u8 = data[0];
+	}
+}
+
+//Write the characters waiting on a port with a single write of the right size
+void ITMFlushPort(uint32_t port)
+{
+	uint8_t bytes[4];
+	uint32_t count = itmPendingCount[port];
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		bytes[i] = itmPendingWord[port] >> (8 * i);
+	}
+	if (count == 3)
+	{
+		ITMWrite(port, bytes, 2); //There is no 24-bit write, so 3 bytes take two writes
+		ITMWrite(port, &bytes[2], 1);
+	}
+	else
+	{
+		ITMWrite(port, bytes, count);
+	}
+
+	itmPendingWord[port] = 0;
+	itmPendingCount[port] = 0;
+}
+
+//Add a character to the caller's stream
+void ITMPutChar(int ch)
+{
+	uint32_t port = ITMCallerPort();
+
+	//Nested interrupts share the ISR port and the threads past port 14 share theirs, so a character on a shared port is never held back
+	if (port == ITM_ISR_PORT || port == ITM_SHARED_THREAD_PORT)
+	{
+		uint8_t byte = ch;
+		ITMWrite(port, &byte, 1);
+		return;
+	}
+
+	itmPendingWord[port] |= (uint32_t)(ch & 0xFF) << (8 * itmPendingCount[port]);
+	itmPendingCount[port]++;
+
+	//Send a full word, and send a line as soon as it ends so output is not held back
+	if (itmPendingCount[port] == 4)
+	{
+		ITMWriteWord(port, itmPendingWord[port]);
+		itmPendingWord[port] = 0;
+		itmPendingCount[port] = 0;
+	}
+	else if (ch == '\n')
+	{
+		ITMFlushPort(port);
+	}
+}
@@ -0,0 +1,38 @@
+/*----------------------------------------------------------------------------
+ * Name: itm.h
+ * Purpose: ITM stimulus port output with one port per thread, written a 32-bit word at a time
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for itm
+#ifndef _itm
+#define _itm
+
+#include "osDefs.h"
+
+//Stimulus port map, the host demultiplexer (tools/itm_demux.py) splits the SWO stream back up by port
+#define ITM_MAIN_PORT 0 //Output before the kernel starts, port 0 is the one the debugger printf window shows
+#define ITM_THREAD_PORT_BASE 1 //Thread n writes to port ITM_THREAD_PORT_BASE + n, for threads 0 to 13
+#define ITM_SHARED_THREAD_PORT 15 //Threads 14 and up share port 15, MAX_THREADS can be larger than the ports left for threads
+#define ITM_SUBSYSTEM_PORT_BASE 16 //Ports 16 to 30 are free for subsystems that want their own stream
+#define ITM_ISR_PORT 31 //Output from interrupt handlers
+
+#define ITM_NUM_PORTS 32
+
+//Enable the stimulus ports used by the port map, does nothing unless the debugger has turned the ITM on
+void ITMInit(void);
+
+//Returns the stimulus port of the caller: its thread port, the ISR port, or the main port before the kernel starts
+uint32_t ITMCallerPort(void);
+
+//Write one 32-bit word to a stimulus port, waiting while the port's FIFO is full
+void ITMWriteWord(uint32_t port, uint32_t word);
+
+//Write a block of bytes to a stimulus port as 32-bit words, with 16 and 8-bit writes for the last bytes
+void ITMWrite(uint32_t port, const uint8_t* data, uint32_t length);
+
+//Add a character to the caller's stream, characters are packed into a word that is written once it is full or a line ends
+//Each thread up to 13 has its own port and word, so no lock is needed; ISRs and the threads sharing port 15 write their characters straight away
+void ITMPutChar(int ch);
+
+#endif
@@ -8,37 +8,101 @@
 #ifndef _osDefs
 #define _osDefs
 
-#include "LPC17xx.h" //This file contains relevant pin and other settings, such as register access functions
+#include "port.h" //This file is the port layer, it brings in the CPU definitions (LPC17xx.h on the board)
 #include "stdio.h" //This file is for printf and other IO functions (used for debugging when needed)
 #include "stdint.h" //This file is for integer definitions
 #include "stddef.h" //This file is for standard definitions
 #include "stdbool.h" //This file is for using bool keyword
 
-//Define the System Handler Priority Register 3 for the location of the PendSV priority register
-#define SHPR3 *(uint32_t*)0xE000ED20
-
-//Define the System Handler Priority Register 2 for the location of the SVC priority register
-#define SHPR2 *(uint32_t*)0xE000ED1C
-
-//Define the Interrupt Control and State Register memory location
-#define ICSR *(uint32_t*)0xE000ED04
-
 //Define stack sizes
 #define MSR_STACK_SIZE 0x400 //Size of the model-specific registers (MSR) reserved memory
-#define THREAD_STACK_SIZE 0x200 //Max thread size offset is 512 = 0x200
-#define MAX_STACK_SIZE 0x2000 //Set the maximum stack size (0x2000)
+#ifndef THREAD_STACK_SIZE
+	#define THREAD_STACK_SIZE 0x200 //Max thread size offset is 512 = 0x200, a board with a larger C library can raise it
+#endif
+#ifndef MAX_STACK_SIZE
+	#define MAX_STACK_SIZE 0x2000 //Set the maximum stack size (0x2000), the host port can make it larger
+#endif
 
 //Stack alignment constants for context switching
 #define SIXTEEN_BYTE_OFFSET 16*4 //Stack PSP offset for PendSV interrupt
 #define EIGHT_BYTE_OFFSET 8*4 //Stack PSP offset for tail-chained interrupts
 
 //Define maximum number of threads
-//10 threads for the user + the idle thread
-#define MAX_THREADS 11
+//10 threads for the user + the idle thread, the host port can raise it for scaling studies
+#ifndef MAX_THREADS
+	#define MAX_THREADS 11
+#endif
 
 //Define the maxium number of mutexes for the array
 #define MAX_MUTEXES 5
 
+//Define the maximum number of lock-free queues for the array
+#define MAX_QUEUES 8
+
+//Define the number of slots in each lock-free queue (must be a power of 2 so the index can be masked)
+#define QUEUE_SIZE 16
+
+//Define the maximum number of wait sets for the array
+#define MAX_WAIT_SETS 4
+
+//Define the maximum number of objects in one wait set (one bit each in the ready mask)
+#define MAX_WAIT_SET_MEMBERS 8
+
+//Kinds of object that can be added to a wait set
+#define WAIT_OBJECT_QUEUE 0 //Ready when a lock-free queue holds an item
+#define WAIT_OBJECT_NOTIFY 1 //Ready when a thread has a notification pending
+
+//Define the maximum number of software timers for the array
+#define MAX_TIMERS 8
+
+//Software timer modes
+#define TIMER_ONE_SHOT 0 //Timer runs its callback once and stops
+#define TIMER_PERIODIC 1 //Timer reloads itself after running its callback
+
+//Define the maximum number of work queues for the array (each work queue uses 2 lock-free queues)
+#define MAX_WORK_QUEUES 2
+
+//Define the maximum number of worker threads that can service one work queue
+#define MAX_WORKERS 2
+
+//Define the number of slots in the CPU usage window, and the length of each slot in ticks (10 x 100ms = 1s window)
+#define CPU_WINDOW_SLOTS 10
+#define CPU_WINDOW_SLOT_TICKS 100
+
+//Define OS_TRACE (here or on the compiler command line) to record scheduler events for tools/trace_to_chrome.py
+//#define OS_TRACE
+
+//Define the number of events the trace ring holds before the oldest are overwritten
+#define TRACE_RING_EVENTS 512
+
+//Define the number of log2 buckets in each wake up latency histogram, the last one also counts every longer latency
+//24 buckets reach 2^23 cycles (84ms at 100MHz)
+#define LATENCY_BUCKETS 24
+
+//Define OS_PROFILE (here or on the compiler command line) to build the TIMER3 PC-sampling profiler for tools/profile_report.py
+//#define OS_PROFILE
+
+//Define the number of (PC, thread) pairs the profile can count (must be a power of 2 so the hash can be masked), samples of pairs that do not fit are counted as dropped
+#define PROFILE_SLOTS 256
+
+//Define the default profiler sampling rate in Hz, a rate that is not a multiple of the 1kHz tick keeps samples from lining up with it
+#define PROFILE_RATE 997
+
+//Define the number of line buffers shared by the threads that printf (must fit in one lock-free queue)
+#define LOG_NUM_LINES 8
+
+//Define the size of each printf line buffer in bytes, a longer line is sent in pieces
+#define LOG_LINE_SIZE 80
+
+//Define the longest command line the shell takes, longer lines are cut off
+#define SHELL_LINE_SIZE 40
+
+//Define the size of the binary log ring in 32-bit words (power of 2)
+#define BINLOG_RING_WORDS 256
+
+//Define how often the binary log thread sends the ring contents (10ms)
+#define BINLOG_FLUSH_PERIOD 10
+
 //Thread states
 #define CREATED 0 //Thread is created
 #define RUNNING 1 //Active thread is running
@@ -49,12 +113,23 @@
 //Timeslice for how long a thread will run (5ms)
 #define TIMESLICE 5
 
+//Value thread stacks are filled with when they are created, words that still hold it have never been used
+#define STACK_PAINT 0xDEADBEEF
+
 //Define the interrupt numbers for SVC
 #define YIELD_SWITCH 0
 
 //Define an empty index for when no data is stored in that location of an array
 #define EMPTY_INDEX -1
 
+//Timeout value for blocking calls that wait until they are woken, however long it takes
+#define WAIT_FOREVER -1
+
+//Thread notification actions
+#define NOTIFY_SET_BITS 0 //OR the value into the notification value
+#define NOTIFY_INCREMENT 1 //Add one to the notification value (the value passed in is ignored)
+#define NOTIFY_OVERWRITE 2 //Replace the notification value
+
 //Define thread struct for each thread stored
 typedef struct thread_struct
 {
@@ -62,6 +137,16 @@ typedef struct thread_struct
 	void (*threadFunc)(void* args); //Thread function pointer
 	int status; //Status of the thread (Running/Waiting/Blocked)
 	int timer; //Timer for the thread
+	int timeslice; //Ticks the thread runs for before the scheduler moves on, TIMESLICE unless osSetTimeslice changes it
+	int blockTimer; //Ticks left before a blocked thread times out (WAIT_FOREVER when it has no timeout)
+	bool timedOut; //Whether the last block ended because blockTimer ran out
+	uint32_t notifyValue; //Notification value sent to the thread with osNotify
+	bool notifyPending; //Whether a notification has been sent that the thread has not taken yet
+	bool notifyWaiting; //Whether the thread is blocked in osNotifyWait
+	int notifyWaitSet; //Wait set signalled when the thread is notified (EMPTY_INDEX if none)
+	int notifyWaitSetMember; //Member index of the notifications in that wait set
+	uint64_t runCycles; //CPU cycles the thread has run for, counted with the DWT cycle counter
+	uint32_t* stackBase; //Lowest address of the thread stack, painted with STACK_PAINT so the deepest use can be found
 }rtosThread;
 
 //Define thread struct for each thread stored
@@ -73,4 +158,89 @@ typedef struct mutex_struct
 	int waitingQueue[MAX_THREADS]; //Waiting queue of all threads waiting for the mutex
 }osMutex;
 
+//Define slot struct for each item stored in a lock-free queue
+typedef struct queue_slot_struct
+{
+	volatile uint32_t sequence; //Sequence number used to hand the slot over between producers and consumers
+	uint32_t item; //Item stored in the slot
+}osQueueSlot;
+
+//Define queue struct for each lock-free queue stored
+typedef struct queue_struct
+{
+	int ID; //ID of the queue
+	volatile uint32_t head; //Position of the next slot to be filled by a producer
+	volatile uint32_t tail; //Position of the next slot to be emptied by a consumer
+	int waitSet; //Wait set signalled when an item is put (EMPTY_INDEX if none)
+	int waitSetMember; //Member index of the queue in that wait set
+	osQueueSlot slots[QUEUE_SIZE]; //Ring of slots holding the queued items
+}osQueue;
+
+//Define wait set struct for each wait set stored
+typedef struct wait_set_struct
+{
+	int ID; //ID of the wait set
+	int owner; //Index of the thread blocked on the wait set (EMPTY_INDEX if no thread is waiting)
+	volatile uint32_t readyMask; //One bit per member that has been signalled since it was last seen empty
+	int lastReady; //Member returned by the last wait, the next wait starts looking after it so no member is starved
+	int numMembers; //Number of objects in the wait set
+	int memberType[MAX_WAIT_SET_MEMBERS]; //Kind of each object (WAIT_OBJECT_QUEUE or WAIT_OBJECT_NOTIFY)
+	int memberIndex[MAX_WAIT_SET_MEMBERS]; //Index of each object in its own array
+}osWaitSet;
+
+//Define timer struct for each software timer stored
+typedef struct timer_struct
+{
+	int ID; //ID of the timer
+	void (*callback)(void* arg); //Function run by the timer service thread when the timer expires
+	void* arg; //Argument passed to the callback
+	int mode; //One-shot or periodic
+	uint32_t period; //Ticks between starting the timer and it expiring, and between periodic expiries
+	uint32_t expiry; //Tick count at which the timer expires
+	bool active; //Whether the timer is in the active list
+	int next; //Index of the timer that expires after this one (EMPTY_INDEX at the end of the list)
+	int previous; //Index of the timer that expires before this one (EMPTY_INDEX at the head of the list)
+}osTimer;
+
+//Define work item struct for each piece of deferred work
+typedef struct work_item_struct
+{
+	void (*func)(void* arg); //Function to run in the worker thread
+	void* arg; //Argument passed to the function
+	uint32_t submitTime; //Cycle count when the item was submitted, used for the latency statistics
+}osWorkItem;
+
+//Define statistics struct for a work queue
+typedef struct work_stats_struct
+{
+	uint32_t submitted; //Number of items submitted
+	uint32_t completed; //Number of items run to completion
+	uint32_t dropped; //Number of items rejected because the queue was full
+	uint32_t depth; //Number of items currently waiting to run
+	uint32_t maxDepth; //Largest number of items that have been waiting at once
+	uint32_t maxLatency; //Longest time in cycles between submitting an item and starting to run it
+	uint64_t totalLatency; //Sum of the latencies of all completed items in cycles
+}osWorkStats;
+
+//Define work queue struct for each work queue stored
+typedef struct work_queue_struct
+{
+	int ID; //ID of the work queue
+	int pendingQueue; //Lock-free queue of item indexes waiting to run, in submission order
+	int freeQueue; //Lock-free queue of item indexes that are free to be submitted
+	osWorkItem items[QUEUE_SIZE]; //Storage for the work items
+	int workers[MAX_WORKERS]; //Indexes of the worker threads servicing the queue
+	int numWorkers; //Number of worker threads servicing the queue
+	osWorkStats stats; //Statistics for the queue
+}osWorkQueue;
+
+//Define latency struct for the wake up latency histogram of each thread
+typedef struct latency_stats_struct
+{
+	uint32_t count; //Number of wake ups measured
+	uint32_t max; //Longest time in cycles between a wake up and the thread running
+	uint64_t total; //Sum of the latencies in cycles
+	uint32_t buckets[LATENCY_BUCKETS]; //Bucket 0 counts latencies of 0 cycles, bucket i counts 2^(i-1) up to 2^i - 1 cycles
+}osLatencyStats;
+
 #endif
@@ -16,6 +16,18 @@
 //Include header file for _mutexAPI
 #include "_mutexAPI.h"
 
+//Include header file for _logAPI
+#include "_logAPI.h"
+
+//Include header file for _shellAPI
+#include "_shellAPI.h"
+
+//Include header file for _profileAPI
+#include "_profileAPI.h"
+
+//Include header file for gpio
+#include "gpio.h"
+
 //Variables for threads to test that they are working
 int x = 0;
 int y = 0;
@@ -23,7 +35,11 @@ int z = 0;
 
 //Define created mutexes
 int mutex_1;
-int mutex_2;
+
+//LED group, LEDs 0 to 2 are P1.28, P1.29, P1.31 and LEDs 3 to 7 are P2.2 to P2.6
+const gpioGroup leds = GPIO_GROUP(LPC_GPIO1, LPC_GPIO2,
+	28, 29, 31, GPIO_NO_PIN, GPIO_NO_PIN, GPIO_NO_PIN, GPIO_NO_PIN, GPIO_NO_PIN,
+	GPIO_NO_PIN, GPIO_NO_PIN, GPIO_NO_PIN, 2, 3, 4, 5, 6);
 
 //Define the threads
 int thread_1;
@@ -121,65 +137,16 @@ void thread2(void* args)
 	//Infinite loop for the thread
 	while (1)
 	{
-		bool acquireMutex1 = osAcquireMutex(thread_2, mutex_1);
-		bool acquireMutex2 = osAcquireMutex(thread_2, mutex_2);
-		
-		//Acquire both mutexes for the global variable and the LEDs
-		if(acquireMutex1 && acquireMutex2)
+		//Acquire the mutex for the global variable, the LEDs do not need one
+		if(osAcquireMutex(thread_2, mutex_1))
 		{
 			printf("Thread 2, x mod 47 is: %d\n", x % 47);
 			
-			//Set the LEDs to x%47
-			//Convert x from decimal to unsigned 8-bit binary
-			unsigned int binary_x = (x % 47);
-			
-			//Check each bit for each LED
-			for(int i = 0; i < 8; i++)
-			{
-				//Check the bit of the integer x
-				if((binary_x >> i) & 1)
-				{
-					//Set the LED
-					if (i < 2)
-					{
-						//Set the first 2 LEDs
-						LPC_GPIO1->FIOSET |= 1<<(28 + i);
-					}
-					else if (i == 2)
-					{
-						//Set the third LED
-						LPC_GPIO1->FIOSET |= 1<<(31);
-					}
-					else 
-					{
-						//Set the last 5 LEDs
-						LPC_GPIO2->FIOSET |= 1<<(i - 1);
-					}
-				}
-				else 
-				{
-					//Clear the LED
-					if (i < 2)
-					{
-						//Clear the first 2 LEDs
-						LPC_GPIO1->FIOCLR |= 1<<(28 + i);
-					}
-					else if (i == 2)
-					{
-						//Clear the third LED
-						LPC_GPIO1->FIOCLR |= 1<<(31);
-					}
-					else 
-					{
-						//Clear the last 5 LEDs
-						LPC_GPIO2->FIOCLR |= 1<<(i - 1);
-					}
-				}
-			}
+			//Set the LEDs to x%47, bit i of the value drives LED i
+			GPIOGroupWrite(&leds, x % 47);
 			
-			//Release the mutexes
+			//Release the mutex
 			osReleaseMutex(thread_2, mutex_1);
-			osReleaseMutex(thread_2, mutex_2);
 		}
 		
 		osYield(); //Yield 
@@ -192,24 +159,11 @@ void thread3(void* args)
 	//Infinite loop for the thread
 	while (1)
 	{
-		//Acquire mutex for the LEDs
-		if(osAcquireMutex(thread_3, mutex_2))
-		{
-			printf("Thread 3\n");
-			
-			//Set the LEDs to 0x71 - 01110001 in binary
-			LPC_GPIO1->FIOCLR |= 1<<28;
-			LPC_GPIO1->FIOSET |= 1<<29;
-			LPC_GPIO1->FIOSET |= 1<<31;	
-			LPC_GPIO2->FIOSET |= 1<<2;	
-			LPC_GPIO2->FIOCLR |= 1<<3;
-			LPC_GPIO2->FIOCLR |= 1<<4;
-			LPC_GPIO2->FIOCLR |= 1<<5; 
-			LPC_GPIO2->FIOSET |= 1<<6;
-			
-			//Release the mutexes
-			osReleaseMutex(thread_3, mutex_2);
-		}
+		printf("Thread 3\n");
+		
+		//Set the LEDs to 0x8E - 10001110 in binary, read from LED 7 down to LED 0
+		//Every LED changes in the same instant, so no mutex is needed
+		GPIOGroupWrite(&leds, 0x8E);
 		
 		osYield(); //Yield  
 	}
@@ -236,20 +190,23 @@ int main(void)
 	thread_2 = create_thread(thread2);
 	thread_3 = create_thread(thread3);
 	
+	//Setup the logger thread so printf no longer blocks the threads while the UART sends
+	osCreateLogger();
+	
+	//Setup the kernel shell on UART2 (P0.10 TxD, P0.11 RxD), uncomment to look at the threads while they run
+	//osCreateShell(2, 115200);
+	
+	//Start the profiler at PROFILE_RATE when it is built in, after the threads are created so they can be named
+#ifdef OS_PROFILE
+	osProfileStart(0);
+#endif
+	
 	//Setup mutexes
 	//Test case #1 & #2
 	mutex_1 = osCreateMutex();
-	mutex_2 = osCreateMutex();
 	
 	//Test Case #2 - Setup the LEDs
-	LPC_GPIO1->FIODIR |= 1<<28;
-	LPC_GPIO1->FIODIR |= 1<<29;
-	LPC_GPIO1->FIODIR |= 1<<31;	
-	LPC_GPIO2->FIODIR |= 1<<2;	
-	LPC_GPIO2->FIODIR |= 1<<3;
-	LPC_GPIO2->FIODIR |= 1<<4;
-	LPC_GPIO2->FIODIR |= 1<<5; 
-	LPC_GPIO2->FIODIR |= 1<<6;
+	GPIOGroupInit(&leds);
 	
 	//Start the kernel
 	kernel_start();
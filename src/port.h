@@ -0,0 +1,101 @@
+/*----------------------------------------------------------------------------
+ * Name: port.h
+ * Purpose: Port layer, everything the kernel needs from the CPU goes through these functions and macros
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for port
+#ifndef _port
+#define _port
+
+#include "stdint.h" //This file is for integer definitions
+#include "stdbool.h" //This file is for using bool keyword
+
+//Exception number of the tick interrupt, the scheduler uses it to tell a timeslice switch from a yield
+#define PORT_TICK_EXCEPTION 15
+
+#ifdef OS_PORT_POSIX
+
+//Host port, threads are ucontexts and the tick is a timer signal (see port/posix)
+#include "port_posix.h"
+
+#else
+
+//Cortex-M3 port, the LPC1768 board unless a board port names its own device header (see port/qemu-mps2)
+#ifdef OS_DEVICE_HEADER
+	#include OS_DEVICE_HEADER
+#else
+	#include "LPC17xx.h" //This file contains relevant pin and other settings, such as register access functions
+#endif
+
+//Define the System Handler Priority Register 3 for the location of the PendSV priority register
+#define SHPR3 *(uint32_t*)0xE000ED20
+
+//Define the System Handler Priority Register 2 for the location of the SVC priority register
+#define SHPR2 *(uint32_t*)0xE000ED1C
+
+//Define the Interrupt Control and State Register memory location
+#define ICSR *(uint32_t*)0xE000ED04
+
+//Disable interrupts, returns the previous interrupt state so sections can nest
+static __INLINE uint32_t portEnterCritical(void)
+{
+	uint32_t state = __get_PRIMASK(); //Save whether interrupts were already disabled
+	__disable_irq(); //Disable interrupts
+	return state;
+}
+
+//Restore the interrupt state saved by portEnterCritical
+#define portExitCritical(state) __set_PRIMASK(state)
+
+//Number of the exception being handled, 0 in a thread
+#define portActiveException() __get_IPSR()
+
+#ifdef PORT_CYCLES_SYSTICK
+//CPU cycle counter built from SysTick for boards whose DWT does not count, wraps every 2^32 cycles like the DWT counter
+uint32_t portCycles(void);
+#else
+//Free running CPU cycle counter
+#define portCycles() (DWT->CYCCNT)
+#endif
+
+//Called by each loop of the idle thread, which just spins until the tick
+#define portIdle() ((void)0)
+
+//Ask for the scheduler, the SVC handler runs osSched and pends PendSV
+#define portYield() __asm("SVC #0")
+
+//Set PendSV exception state to pending to switch threads when all other interrupts are done
+//Bit 28 of this register controls the behaviour of PendSV, the isb clears the pipeline before the interrupt is triggered
+#define portPendSwitch() do { ICSR |= 1<<28; __asm("isb"); } while (0)
+
+//Stack pointer of the thread being switched out, the PendSV handler pushes the remaining registers PSP_Offset bytes below PSP
+#define portSavedStack(PSP_Offset) ((uint32_t*)(__get_PSP() - (PSP_Offset)))
+
+//Stack pointer of the thread being switched in, the PendSV handler pops its registers from PSP
+#define portRestoreStack(stack) __set_PSP((uint32_t)(stack))
+
+//Initial location of MSP, stored at address 0x00 in the vector table, the thread stacks are placed below it
+#define portInitialMSP() ((uint32_t*)*(uint32_t*)0)
+
+//Sets the value of PSP to threadStack and ensures that the microcontroller is using that value by changing the CONTROL register
+void setThreadingWithPSP(uint32_t* threadStack);
+
+//SVC handler function, called by SVC_Handler in svc_call.s with the stacked registers
+void SVC_Handler_Main(uint32_t *svc_args);
+
+#endif
+
+//Set up the CPU for the kernel (interrupt priorities and the cycle counter)
+void portInit(void);
+
+//Build the first context of a thread below stack, returns the stack pointer the thread starts from
+uint32_t* portInitThreadStack(int thread_index, uint32_t* stack, void (*func)(void* args));
+
+//Start the 1ms tick that calls SysTick_Handler
+void portStartTick(void);
+
+//Run the first thread, does not return
+void portStartFirstThread(uint32_t* stack);
+
+#endif
@@ -0,0 +1,114 @@
+/*----------------------------------------------------------------------------
+ * Name: port_cm3.c
+ * Purpose: Cortex-M3 port layer, sets up the exceptions and thread stacks that svc_call.s switches between
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for _kernelCore and port
+#include "_kernelCore.h"
+#include "port.h"
+
+//Set up the CPU for the kernel
+void portInit(void)
+{
+	//Define the priorities of the PendSV, SysTick, and SVC interrupts
+	SHPR3 |= 0xFE << 16; //Set the priority of PendSV to almost the weakest (0xFE)
+	SHPR3 |= 0xFFU << 24; //Set the priority of SysTick to be the weakest (0xFFU)
+	SHPR2 |= 0xFDU << 24; //Set the priority of SVC the be the strongest (0xFDU)
+
+	//Start the DWT cycle counter, which the kernel uses to timestamp events
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; //Enable the trace block
+	DWT->CYCCNT = 0; //Reset the cycle counter
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; //Start the cycle counter
+}
+
+#ifdef PORT_CYCLES_SYSTICK
+
+uint32_t portSysTickWraps = 0; //Number of times SysTick has reloaded, counted from COUNTFLAG
+
+//CPU cycle counter built from SysTick, counts down from LOAD once per tick
+//The reloads are counted here rather than with the tick count, the SysTick handler reads the cycles before it counts the tick
+//Reading CTRL clears COUNTFLAG, so this has to run at least once per tick, which the SysTick handler does
+uint32_t portCycles(void)
+{
+	uint32_t state = portEnterCritical(); //An interrupt reading the counter in between would take the COUNTFLAG
+	uint32_t value = SysTick->VAL;
+
+	//The counter reloaded since the last call, read it again in case that happened after the first read
+	if (SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk)
+	{
+		portSysTickWraps++;
+		value = SysTick->VAL;
+	}
+
+	uint32_t cycles = portSysTickWraps * (SysTick->LOAD + 1) + (SysTick->LOAD - value);
+	portExitCritical(state);
+	return cycles;
+}
+
+#endif
+
+//Build the exception frame PendSV pops when the thread first runs
+uint32_t* portInitThreadStack(int thread_index, uint32_t* stack, void (*func)(void* args))
+{
+	//Set 24th bit of the SP, this sets xpsr (status register)
+	*(--stack) = 1<<24;
+
+	//Store the PC as the function we will be running
+	*(--stack) = (uint32_t)func;
+
+	//Store the next registers LR, R12, R3, R2, R1, R0
+	//LR=0xE, R12=0xD, R3=0xC, R2=0xB, R1=0xA, R0=0x9
+	for (uint32_t i = 0xE; i > 0x8; i--)
+	{
+		*(--stack) = i;
+	}
+
+	//Store the next registers R11 through R4
+	//R11=0xB, R10=0xA, R9=0x9, R8=0x8, R7=0x7, R6=0x6, R5=0x5, R4=0x4
+	for (uint32_t i = 0xB; i > 0x3; i--)
+	{
+		*(--stack) = i;
+	}
+	return stack;
+}
+
+//Start the 1ms tick
+void portStartTick(void)
+{
+	SysTick_Config(SystemCoreClock/1000); //Configure the SysTick timer
+}
+
+//Run the first thread
+void portStartFirstThread(uint32_t* stack)
+{
+	setThreadingWithPSP(stack); //Set thread mode and SP to PSP by calling setThreadingWithPSP function
+	osYield(); //Yield
+}
+
+//Sets the value of PSP to threadStack and ensures that the microcontroller is using that value by changing the CONTROL register
+void setThreadingWithPSP(uint32_t* threadStack)
+{
+	//Set PSP to the new thread stack address
+	__set_PSP((uint32_t)threadStack);
+
+	//Switch to threading mode by setting the CONTROL, which involves shifting a 1 into its 1st bit
+	__set_CONTROL(1<<1);
+}
+
+//SVC handler function
+void SVC_Handler_Main(uint32_t *svc_args)
+{
+	//Get the argument from the stack
+	char call = ((char*)svc_args[6])[-2];
+
+	//Yield Switch
+	if(call == YIELD_SWITCH)
+	{
+		//Run the scheduler
+		osSched(EIGHT_BYTE_OFFSET);
+
+		//Switch threads once the SVC handler returns
+		portPendSwitch();
+	}
+}
@@ -0,0 +1,254 @@
+/*----------------------------------------------------------------------------
+ * Name: queue_bench.c
+ * Purpose: Benchmark of the lock-free queue against a mutex protected ring under heavy preemption
+ *          Build this file instead of p1_main.c to run the benchmark
+ *----------------------------------------------------------------------------
+*/
+
+//This file contains relevant pin and other settings
+#include <LPC17xx.h>
+
+//This file is for printf and other IO functions
+#include "stdio.h"
+
+//This file is for the printf formats of the fixed width integers (PRIu32)
+#include "inttypes.h"
+
+//Include header file for _threadsCore
+#include "_threadsCore.h"
+
+//Include header file for _kernelCore
+#include "_kernelCore.h"
+
+//Include header file for _mutexAPI
+#include "_mutexAPI.h"
+
+//Include header file for _queueAPI
+#include "_queueAPI.h"
+
+//Number of producer threads (the TIMER0 interrupt is an extra producer on top of these)
+#define NUM_PRODUCERS 3
+
+//Rate of the TIMER0 interrupt producer (20kHz)
+#define ISR_PRODUCER_RATE 20000
+
+//Number of items the consumer takes before printing a report
+#define REPORT_INTERVAL 2000
+
+//Statistics collected for one way of putting items
+typedef struct bench_stats_struct
+{
+	uint32_t min; //Fastest put in cycles
+	uint32_t max; //Slowest put in cycles
+	uint64_t total; //Sum of all put times in cycles
+	uint32_t count; //Number of successful puts
+	uint32_t failed; //Number of puts that found the queue full or the mutex taken
+}benchStats;
+
+//Lock-free queue shared by all producers
+int lockFreeQueue;
+
+//Mutex protected ring shared by the producer threads (an ISR cannot take a mutex so it is thread only)
+int ringMutex;
+uint32_t mutexRing[QUEUE_SIZE];
+uint32_t mutexRingHead = 0;
+uint32_t mutexRingTail = 0;
+
+//Producer and consumer thread indexes
+int producerThreads[NUM_PRODUCERS];
+int consumerThread;
+
+//Statistics, one entry per producer plus the ISR for the lock-free queue
+benchStats lockFreeStats[NUM_PRODUCERS + 1];
+benchStats mutexStats[NUM_PRODUCERS];
+
+//Add one measurement to a set of statistics
+void benchRecord(benchStats* stats, uint32_t cycles, bool success)
+{
+	//Only successful puts are timed
+	if (!success)
+	{
+		stats->failed++;
+		return;
+	}
+
+	if (stats->count == 0 || cycles < stats->min)
+	{
+		stats->min = cycles;
+	}
+	if (cycles > stats->max)
+	{
+		stats->max = cycles;
+	}
+	stats->total += cycles;
+	stats->count++;
+}
+
+//Put an item into the mutex protected ring, returns false if the mutex is taken or the ring is full
+bool mutexRingPut(int thread_index, uint32_t item)
+{
+	bool success = false;
+
+	if (osAcquireMutex(thread_index, ringMutex))
+	{
+		//Only store the item if there is room in the ring
+		if (mutexRingHead - mutexRingTail < QUEUE_SIZE)
+		{
+			mutexRing[mutexRingHead % QUEUE_SIZE] = item;
+			mutexRingHead++;
+			success = true;
+		}
+		osReleaseMutex(thread_index, ringMutex);
+	}
+	return success;
+}
+
+//Take an item out of the mutex protected ring, returns false if the mutex is taken or the ring is empty
+bool mutexRingGet(int thread_index, uint32_t* item)
+{
+	bool success = false;
+
+	if (osAcquireMutex(thread_index, ringMutex))
+	{
+		//Only take an item if the ring is not empty
+		if (mutexRingHead != mutexRingTail)
+		{
+			*item = mutexRing[mutexRingTail % QUEUE_SIZE];
+			mutexRingTail++;
+			success = true;
+		}
+		osReleaseMutex(thread_index, ringMutex);
+	}
+	return success;
+}
+
+//Common body of every producer thread
+//Each iteration puts one item with each approach and times it with the cycle counter
+void producer(int id)
+{
+	uint32_t sequence = 0; //Sequence number of the items put by this producer
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		uint32_t item = (id << 24) | (sequence & 0xFFFFFF); //Tag each item with the producer that put it
+
+		uint32_t start = DWT->CYCCNT;
+		bool success = osQueuePut(lockFreeQueue, item);
+		benchRecord(&lockFreeStats[id], DWT->CYCCNT - start, success);
+
+		start = DWT->CYCCNT;
+		success = mutexRingPut(producerThreads[id], item);
+		benchRecord(&mutexStats[id], DWT->CYCCNT - start, success);
+
+		sequence++;
+	}
+}
+
+//Producer threads, identical apart from the ID they pass in
+void producer1(void* args)
+{
+	producer(0);
+}
+
+void producer2(void* args)
+{
+	producer(1);
+}
+
+void producer3(void* args)
+{
+	producer(2);
+}
+
+//Print the statistics for one producer as a CSV line
+void benchPrint(const char* method, int id, benchStats* stats)
+{
+	uint32_t average = (stats->count > 0) ? (uint32_t)(stats->total / stats->count) : 0;
+	printf("%s,%d,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n", method, id, stats->count, stats->failed, stats->min, average, stats->max);
+}
+
+//Consumer thread, drains both queues and prints a report every REPORT_INTERVAL items
+void consumer(void* args)
+{
+	uint32_t item; //Item taken from a queue
+	uint32_t taken = 0; //Number of items taken since the last report
+
+	//Infinite loop for the thread
+	while (1)
+	{
+		while (osQueueGet(lockFreeQueue, &item))
+		{
+			taken++;
+		}
+
+		while (mutexRingGet(consumerThread, &item))
+		{
+			taken++;
+		}
+
+		if (taken >= REPORT_INTERVAL)
+		{
+			printf("method,producer,puts,failed,min_cycles,avg_cycles,max_cycles\n");
+			for (int i = 0; i < NUM_PRODUCERS; i++)
+			{
+				benchPrint("lockfree", i, &lockFreeStats[i]);
+				benchPrint("mutex", i, &mutexStats[i]);
+			}
+			benchPrint("lockfree_isr", NUM_PRODUCERS, &lockFreeStats[NUM_PRODUCERS]);
+			taken = 0;
+		}
+
+		osYield(); //Yield
+	}
+}
+
+//TIMER0 interrupt, an extra producer that preempts the producer threads at any point
+void TIMER0_IRQHandler(void)
+{
+	static uint32_t sequence = 0; //Sequence number of the items put by the interrupt
+
+	LPC_TIM0->IR = 1; //Clear the MR0 interrupt
+
+	uint32_t start = DWT->CYCCNT;
+	bool success = osQueuePut(lockFreeQueue, (NUM_PRODUCERS << 24) | (sequence & 0xFFFFFF));
+	benchRecord(&lockFreeStats[NUM_PRODUCERS], DWT->CYCCNT - start, success);
+	sequence++;
+}
+
+//Start TIMER0 so it interrupts at ISR_PRODUCER_RATE
+void benchTimerInit(void)
+{
+	//PCLK for TIMER0 is 1/4 of the system clock by default (bits 2~3 of PCLKSEL0)
+	LPC_TIM0->MR0 = (SystemCoreClock / 4) / ISR_PRODUCER_RATE - 1;
+	LPC_TIM0->MCR = 3; //Interrupt and reset the counter on MR0
+	LPC_TIM0->TCR = 1; //Start the timer
+	NVIC_EnableIRQ(TIMER0_IRQn);
+}
+
+int main(void)
+{
+	//Always call this function at the start. It sets up various peripherals, the clock etc.
+	SystemInit();
+
+	//kernelInit also starts the DWT cycle counter used for every measurement
+	kernelInit();
+
+	//Setup the queues
+	lockFreeQueue = osCreateQueue();
+	ringMutex = osCreateMutex();
+
+	//Setup threads
+	producerThreads[0] = create_thread(producer1);
+	producerThreads[1] = create_thread(producer2);
+	producerThreads[2] = create_thread(producer3);
+	consumerThread = create_thread(consumer);
+
+	benchTimerInit();
+
+	//Start the kernel
+	kernel_start();
+
+	//Your code should always terminate in an endless loop if it is done
+	while(1);
+}
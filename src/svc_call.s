@@ -3,6 +3,8 @@
 	EXTERN SVC_Handler_Main ;External C function for SVC handler
 	GLOBAL PendSV_Handler ;Declare global function to handle the PendSV interrupt
 	GLOBAL SVC_Handler ;Declare global function to handle the SVC interrupt
+	EXTERN osProfileSample ;External C function that counts a profiler sample
+	GLOBAL TIMER3_IRQHandler ;Declare global function to handle the profiler timer interrupt
 	PRESERVE8 ;Stack will lie on 8 byte boundary
 
 PendSV_Handler ;Define PendSV_Handler function
@@ -27,4 +29,12 @@ SVC_Handler ;Define SVC_Handler function
 	MRSNE r0, PSP ;Load R0 with PSP when test is false
 	B SVC_Handler_Main ;Branch to C function
 
+TIMER3_IRQHandler ;Define TIMER3_IRQHandler function, the profiler's sampling interrupt
+	TST LR,#4 ;Test whether the interrupted code was using MSP or PSP
+	ITE EQ ;If-Then-Else construct
+	MRSEQ r0, MSP ;Load R0 with MSP when test is true
+	MRSNE r0, PSP ;Load R0 with PSP when test is false
+	MOV r1, LR ;Pass EXC_RETURN so the C function can tell a handler from a thread
+	B osProfileSample ;Branch to C function, it returns from the interrupt
+
 	END ;End of file
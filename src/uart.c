@@ -21,21 +21,46 @@
 #include "lpc17xx.h"
 //#include "type.h"
 #include "uart.h"
+#include "_kernelCore.h"
+#include "_cpuAPI.h"
 
 //#ifdef __DBG_ITM
 volatile int ITM_RxBuffer = ITM_RXBUFFER_EMPTY;  /*  CMSIS Debug Input        */
 //#endif
 
-volatile uint32_t UART0Status, UART1Status;
-volatile uint8_t UART0TxEmpty = 1, UART1TxEmpty = 1;
-volatile uint8_t UART0Buffer[BUFSIZE], UART1Buffer[BUFSIZE];
-volatile uint32_t UART0Count = 0, UART1Count = 0;
-
-volatile uint8_t RcvLock0; 
-volatile uint8_t SndLock0; 
-
-volatile uint8_t RcvLock1; 
-volatile uint8_t SndLock1; 
+/* Port descriptors, one per UART. Every field is a constant so a call with a
+   constant port number reduces to direct register accesses. */
+const UART_PORT UARTPorts[UART_NUM_PORTS] =
+{
+	/* UART0: TxD0 P0.2, RxD0 P0.3, PCLKSEL0 bits 6~7 */
+	{ (LPC_UART_TypeDef *)LPC_UART0, UART0_IRQn, &LPC_SC->PCLKSEL0, 6, 1U << 3, &LPC_PINCON->PINSEL0, 0x000000F0, 0x00000050 },
+	/* UART1: TxD1 P2.0, RxD1 P2.1, PCLKSEL0 bits 8~9 */
+	{ (LPC_UART_TypeDef *)LPC_UART1, UART1_IRQn, &LPC_SC->PCLKSEL0, 8, 1U << 4, &LPC_PINCON->PINSEL4, 0x0000000F, 0x0000000A },
+	/* UART2: TxD2 P0.10, RxD2 P0.11, PCLKSEL1 bits 16~17 */
+	{ (LPC_UART_TypeDef *)LPC_UART2, UART2_IRQn, &LPC_SC->PCLKSEL1, 16, 1U << 24, &LPC_PINCON->PINSEL0, 0x00F00000, 0x00500000 },
+	/* UART3: TxD3 P0.0, RxD3 P0.1, PCLKSEL1 bits 18~19 */
+	{ (LPC_UART_TypeDef *)LPC_UART3, UART3_IRQn, &LPC_SC->PCLKSEL1, 18, 1U << 25, &LPC_PINCON->PINSEL0, 0x0000000F, 0x0000000A },
+};
+
+volatile uint32_t UARTStatus[UART_NUM_PORTS];	/* last receive line status error of each port */
+
+/* Receive rings, filled by the RDA and CTI interrupts and emptied by UARTRecieve.
+   Head is only written by the interrupt, tail only by the reader holding RcvLock. */
+volatile uint8_t UARTRxBuffer[UART_NUM_PORTS][RX_BUFSIZE];
+volatile uint32_t UARTRxHead[UART_NUM_PORTS];
+volatile uint32_t UARTRxTail[UART_NUM_PORTS];
+volatile uint32_t UARTRxOverflow[UART_NUM_PORTS];	/* bytes dropped because the ring was full */
+volatile int UARTRxWaiter[UART_NUM_PORTS] = { EMPTY_INDEX, EMPTY_INDEX, EMPTY_INDEX, EMPTY_INDEX };	/* thread blocked on received data */
+
+/* Transmit rings, filled by UARTSend and drained into the TX FIFO by the THRE interrupt.
+   Head is only written by the sender holding SndLock, tail only by the interrupt. */
+volatile uint8_t UARTTxBuffer[UART_NUM_PORTS][TX_BUFSIZE];
+volatile uint32_t UARTTxHead[UART_NUM_PORTS];
+volatile uint32_t UARTTxTail[UART_NUM_PORTS];
+volatile int UARTTxWaiter[UART_NUM_PORTS] = { EMPTY_INDEX, EMPTY_INDEX, EMPTY_INDEX, EMPTY_INDEX };	/* thread blocked on ring space */
+
+volatile uint8_t RcvLock[UART_NUM_PORTS];
+volatile uint8_t SndLock[UART_NUM_PORTS];
 
 volatile int i = 0;
 
@@ -54,131 +79,200 @@ uint8_t Lock(volatile uint8_t *tbl){
 }
 
 uint8_t LockRcv(uint8_t portNum){
-	if(portNum > 1)
+	if(portNum >= UART_NUM_PORTS)
 		return 0x1;
-	return Lock(portNum == 0? &RcvLock0 : &RcvLock1);
+	return Lock(&RcvLock[portNum]);
 }
 
 uint8_t LockSnd(uint8_t portNum){
-	if(portNum > 1)
+	if(portNum >= UART_NUM_PORTS)
 		return 0x1;
-	return Lock(portNum == 0? &SndLock0 : &SndLock1);
+	return Lock(&SndLock[portNum]);
 }
 
 void FreeRcv(uint8_t portNum){
-	if(portNum > 1)
+	if(portNum >= UART_NUM_PORTS)
 		return;
-	Free( portNum == 0? &RcvLock0 : &RcvLock1 );
+	Free(&RcvLock[portNum]);
 }
 
 void FreeSnd(uint8_t portNum){
-	if(portNum > 1)
+	if(portNum >= UART_NUM_PORTS)
 		return;
-	Free( portNum == 0? &SndLock0 : &SndLock1 );
+	Free(&SndLock[portNum]);
 }
 
 
 /*****************************************************************************
-** Function name:		UART0_IRQHandler
+** Function name:		UARTTxFill
 **
-** Descriptions:		UART0 interrupt handler
+** Descriptions:		Move up to one FIFO worth of bytes from the transmit
+**						ring into the TX FIFO. Only does anything once the
+**						FIFO is empty, the next THRE interrupt continues.
+**						Called from the UART interrupt, or with interrupts
+**						disabled to start an idle transmitter.
 **
-** parameters:			None
+** parameters:			portNum
 ** Returned value:		None
 ** 
 *****************************************************************************/
-void UART0_IRQHandler (void) 
+static __INLINE void UARTTxFill( uint32_t portNum )
 {
-	uint8_t IIRValue, LSRValue;
-
-	IIRValue = LPC_UART0->IIR;
+	LPC_UART_TypeDef *LPC_UART = UARTPorts[portNum].UART;
+	uint32_t tail = UARTTxTail[portNum];
+	uint32_t count = 0;
 
-	IIRValue >>= 1;			/* skip pending bit in IIR */
-	IIRValue &= 0x07;			/* check bit 1~3, interrupt identification */
+	if ( !(LPC_UART->LSR & LSR_THRE) )
+	{
+		return;		/* FIFO still holds data, THRE will fire when it empties */
+	}
 
-	LSRValue = LPC_UART0->LSR;
+	while ( tail != UARTTxHead[portNum] && count < TX_FIFO_SIZE )
+	{
+		LPC_UART->THR = UARTTxBuffer[portNum][tail & (TX_BUFSIZE - 1)];
+		tail++;
+		count++;
+	}
+	UARTTxTail[portNum] = tail;
 
-	if ( LSRValue & LSR_RDR )	/* Receive Data Ready */	
+	/* Space was freed, let a blocked sender continue */
+	if ( count != 0 && UARTTxWaiter[portNum] != EMPTY_INDEX )
 	{
-		/* If no error on RLS, normal ready, save into the data buffer. */
-		/* Note: read RBR will clear the interrupt */
-		UART0Buffer[UART0Count] = LPC_UART0->RBR;
-		UART0Count++;
-		if ( UART0Count == BUFSIZE )
-		{
-		UART0Count = 0;		/* buffer overflow */
-		}
+		osWakeThread( UARTTxWaiter[portNum] );
 	}
+}
 
-	if ( IIRValue == IIR_THRE )	/* THRE, transmit holding register empty */
+/*****************************************************************************
+** Function name:		UARTRxDrain
+**
+** Descriptions:		Move every byte in the RX FIFO into the receive
+**						ring. Called on RDA (FIFO reached the trigger
+**						level) and CTI (bytes below the trigger level sat
+**						in the FIFO for 3.5 to 4.5 character times), so a
+**						burst costs one interrupt per trigger level.
+**
+** parameters:			portNum
+** Returned value:		None
+** 
+*****************************************************************************/
+static __INLINE void UARTRxDrain( uint32_t portNum )
+{
+	LPC_UART_TypeDef *LPC_UART = UARTPorts[portNum].UART;
+	uint32_t head = UARTRxHead[portNum];
+	uint8_t data;
+
+	/* Note: read RBR will clear the interrupt */
+	while ( LPC_UART->LSR & LSR_RDR )
 	{
-	/* THRE interrupt */
-		LSRValue = LPC_UART0->LSR;		/* Check status in the LSR to see if
-									valid data in U0THR or not */
-		if ( LSRValue & LSR_THRE ){
-			UART0TxEmpty = 1;
+		data = LPC_UART->RBR;
+		if ( head - UARTRxTail[portNum] < RX_BUFSIZE )
+		{
+			UARTRxBuffer[portNum][head & (RX_BUFSIZE - 1)] = data;
+			head++;
 		}
-		else{
-			UART0TxEmpty = 0;
+		else
+		{
+			UARTRxOverflow[portNum]++;		/* buffer overflow */
 		}
 	}
+	UARTRxHead[portNum] = head;
 
+	/* Data arrived, let a blocked reader continue */
+	if ( UARTRxWaiter[portNum] != EMPTY_INDEX )
+	{
+		osWakeThread( UARTRxWaiter[portNum] );
+	}
 }
 
 /*****************************************************************************
-** Function name:		UART1_IRQHandler
+** Function name:		UARTIRQHandler
 **
-** Descriptions:		UART1 interrupt handler
+** Descriptions:		Interrupt handler shared by every port. Each
+**						UARTn_IRQHandler passes its own constant port
+**						number, so this is inlined into a handler that
+**						touches that port's registers directly.
 **
-** parameters:			None
+** parameters:			portNum
 ** Returned value:		None
 ** 
 *****************************************************************************/
-void UART1_IRQHandler (void) 
+static __INLINE void UARTIRQHandler( uint32_t portNum )
 {
-
+	LPC_UART_TypeDef *LPC_UART = UARTPorts[portNum].UART;
 	uint8_t IIRValue, LSRValue;
 
-	IIRValue = LPC_UART1->IIR;
+	osISREnter();		/* time in the handler is not charged to the interrupted thread */
+
+	IIRValue = LPC_UART->IIR;
 
 	IIRValue >>= 1;			/* skip pending bit in IIR */
 	IIRValue &= 0x07;			/* check bit 1~3, interrupt identification */
 
-	LSRValue = LPC_UART1->LSR;
-
-	if ( LSRValue & LSR_RDR )	/* Receive Data Ready */	
+	if ( IIRValue == IIR_RLS )		/* Receive Line Status */
 	{
-		/* If no error on RLS, normal ready, save into the data buffer. */
-		/* Note: read RBR will clear the interrupt */
-		UART1Buffer[UART1Count] = LPC_UART1->RBR;
-		UART1Count++;
-		if ( UART1Count == BUFSIZE ){
-		UART0Count = 0;		/* buffer overflow */
+		LSRValue = LPC_UART->LSR;	/* reading LSR clears the interrupt */
+		if ( LSRValue & (LSR_OE|LSR_PE|LSR_FE|LSR_RXFE|LSR_BI) )
+		{
+			UARTStatus[portNum] = LSRValue;
+			if ( LSRValue & LSR_RDR )
+			{
+				LSRValue = LPC_UART->RBR;	/* discard the byte in error */
+			}
 		}
 	}
 
+	if ( IIRValue == IIR_RDA || IIRValue == IIR_CTI )	/* Receive Data Available or Character Time-out */
+	{
+		UARTRxDrain( portNum );
+	}
+
 	if ( IIRValue == IIR_THRE )	/* THRE, transmit holding register empty */
 	{
-	/* THRE interrupt */
-		LSRValue = LPC_UART1->LSR;		/* Check status in the LSR to see if
-									valid data in U0THR or not */
-		if ( LSRValue & LSR_THRE ){
-			UART1TxEmpty = 1;
-		}
-		else{
-			UART1TxEmpty = 0;
-		}
+		/* Refill the whole FIFO from the transmit ring */
+		UARTTxFill( portNum );
 	}
 
+	osISRExit();
 }
 
-/* By default, the PCLKSELx value is zero, thus, the PCLK for
-	all the peripherals is 1/4 of the SystemFrequency. */
-uint32_t getFrequency(uint32_t clk_slct){
+/*****************************************************************************
+** Function name:		UART0_IRQHandler ... UART3_IRQHandler
+**
+** Descriptions:		UART0 to UART3 interrupt handlers
+**
+** parameters:			None
+** Returned value:		None
+** 
+*****************************************************************************/
+void UART0_IRQHandler (void) 
+{
+	UARTIRQHandler( 0 );
+}
+
+void UART1_IRQHandler (void) 
+{
+	UARTIRQHandler( 1 );
+}
+
+void UART2_IRQHandler (void) 
+{
+	UARTIRQHandler( 2 );
+}
+
+void UART3_IRQHandler (void) 
+{
+	UARTIRQHandler( 3 );
+}
+
+/* PCLK produced by each PCLKSELx code. At reset the PCLKSELx value
+	is zero, thus, the PCLK for all the peripherals is 1/4 of the
+	SystemFrequency. SystemInit sets the UARTs to CCLK (PCLKSELx_Val
+	in system_LPC17xx.c). */
+uint32_t getPclk( uint32_t clk_slct ){
 
 	uint32_t pclk;
 
-	switch ( (LPC_SC->PCLKSEL0 >> clk_slct) & 0x03 )
+	switch ( clk_slct & 0x03 )
 	{
 		case 0x00:
 		default:
@@ -198,135 +292,280 @@ uint32_t getFrequency(uint32_t clk_slct){
 	return pclk;
 }
 
+/* PCLK currently selected for a port */
+uint32_t getFrequency( uint32_t portNum ){
+	return getPclk( *UARTPorts[portNum].PCLKSEL >> UARTPorts[portNum].PCLKShift );
+}
+
+/* Achieved setting of each port, filled in by UARTSetBaud */
+UART_BAUD UARTBaud[UART_NUM_PORTS];
+
 /*****************************************************************************
-** Function name:		UARTInit
+** Function name:		UARTBaudSearch
 **
-** Descriptions:		Initialize UART port, setup pin select,
-**						clock, parity, stop bits, FIFO, etc.
+** Descriptions:		Find the divider setting closest to a baud rate.
+**						The rate is PCLK * MulVal / (16 * DL * (MulVal +
+**						DivAddVal)), so every PCLKSEL code allowed by
+**						pclkMask and every legal MulVal/DivAddVal pair is
+**						tried with the divisor latch values either side
+**						of the exact one. The reset PCLK and the integer
+**						divider are tried first so they win a tie.
 **
-** parameters:			portNum(0 or 1) and UART baudrate
-** Returned value:		true or false, return false only if the 
-**						interrupt handler can't be installed to the 
-**						VIC table
+** parameters:			baudrate, mask of allowed PCLKSEL codes (bit n
+**						allows code n) and the result to fill in
+** Returned value:		true or false, false if nothing was found
 ** 
 *****************************************************************************/
-uint32_t UARTInit( uint32_t PortNum, uint32_t baudrate )
+uint32_t UARTBaudSearch( uint32_t baudrate, uint32_t pclkMask, UART_BAUD *baud )
 {
-	uint32_t Fdiv;
-	uint32_t  pclk;
+	const uint8_t pclkOrder[4] = { 0x00, 0x02, 0x01, 0x03 };	/* CCLK/4, /2, /1, /8 */
+	uint64_t bestError = UINT64_MAX;
+	uint32_t sel, pclk, mulVal, divAddVal, dl, dlFloor, k;
+	uint64_t denominator, actual, target, error;
+
+	if ( baudrate == 0 )
+		return( FALSE );
 
-	if ( PortNum == 0 )
+	target = (uint64_t)baudrate * 1000;		/* compare in milli-baud */
+
+	for ( k = 0; k < 4; k++ )
 	{
-		LPC_PINCON->PINSEL0 &= ~0x000000F0;
-		LPC_PINCON->PINSEL0 |= 0x00000050;  /* RxD0 is P0.3 and TxD0 is P0.2 */
+		sel = pclkOrder[k];
+		if ( !(pclkMask & (1U << sel)) )
+			continue;
+		pclk = getPclk( sel );
+
+		for ( mulVal = 1; mulVal <= 15; mulVal++ )
+		{
+			for ( divAddVal = 0; divAddVal < mulVal; divAddVal++ )
+			{
+				if ( divAddVal == 0 && mulVal != 1 )
+					continue;		/* the fractional divider is off, MulVal does not matter */
+
+				dlFloor = (uint32_t)( ((uint64_t)pclk * mulVal) / ((uint64_t)16 * baudrate * (mulVal + divAddVal)) );
+
+				for ( dl = dlFloor; dl <= dlFloor + 1; dl++ )
+				{
+					/* DL is 16 bits, and has to be at least 3 while the fractional divider is on */
+					if ( dl == 0 || dl > 0xFFFF || (divAddVal != 0 && dl < 3) )
+						continue;
+
+					denominator = (uint64_t)16 * dl * (mulVal + divAddVal);
+					actual = ((uint64_t)pclk * mulVal * 1000 + denominator / 2) / denominator;
+					error = actual > target ? actual - target : target - actual;
+
+					if ( error < bestError )
+					{
+						bestError = error;
+						baud->pclkSel = sel;
+						baud->divisor = dl;
+						baud->divAddVal = divAddVal;
+						baud->mulVal = mulVal;
+						baud->actual = (uint32_t)((actual + 500) / 1000);
+						baud->errorPPM = (int32_t)( ((int64_t)actual - (int64_t)target) * 1000 / (int64_t)baudrate );
+					}
+				}
+			}
+		}
+	}
+
+	return( bestError != UINT64_MAX );
+}
+
+/*****************************************************************************
+** Function name:		UARTSetBaud
+**
+** Descriptions:		Select the divisor latch and fractional divider
+**						with the lowest error for a baud rate, using the
+**						PCLK the port already runs from, and program
+**						them. The setting is only applied if the error
+**						is within UART_BAUD_MAX_ERROR_PPM. The achieved
+**						rate and error are left in UARTBaud.
+**						PCLKSEL is never written here, per the LPC176x
+**						errata a write after PLL0 is connected may not
+**						take effect, so the UART clocks are chosen by
+**						PCLKSELx_Val in system_LPC17xx.c instead.
+**
+** parameters:			portNum(0 to 3) and UART baudrate
+** Returned value:		true or false, false if the port is out of range
+**						or no setting is accurate enough
+** 
+*****************************************************************************/
+uint32_t UARTSetBaud( uint32_t portNum, uint32_t baudrate )
+{
+	const UART_PORT *port;
+	UART_BAUD baud;
+	uint32_t lcr, sel;
 
-		/* Bit 6~7 is for UART0 */
-		pclk = getFrequency(6);
+	if ( portNum >= UART_NUM_PORTS )
+		return( FALSE );
 
-		LPC_UART0->LCR = 0x83;		/* 8 bits, no Parity, 1 Stop bit, The access to Divisor latches is enabled. */
+	port = &UARTPorts[portNum];
+	sel = (*port->PCLKSEL >> port->PCLKShift) & 0x03;
 
-		Fdiv = ( pclk / 16 ) / baudrate ;	/*baud rate */
-		LPC_UART0->DLM = Fdiv / 256;					
-		LPC_UART0->DLL = Fdiv % 256;
+	if ( !UARTBaudSearch( baudrate, 1U << sel, &baud ) )
+		return( FALSE );
 
-		LPC_UART0->LCR = 0x03;		/* DLAB = 0 */
-		LPC_UART0->FCR = 0x07;		/* Enable and reset TX and RX FIFO. */
+	if ( baud.errorPPM > UART_BAUD_MAX_ERROR_PPM || baud.errorPPM < -UART_BAUD_MAX_ERROR_PPM )
+		return( FALSE );
 
-	 	NVIC_EnableIRQ(UART0_IRQn);
+	lcr = port->UART->LCR & ~0x80;
+	port->UART->LCR = lcr | 0x80;		/* The access to Divisor latches is enabled. */
+	port->UART->DLM = baud.divisor / 256;
+	port->UART->DLL = baud.divisor % 256;
+	port->UART->FDR = (baud.mulVal << 4) | baud.divAddVal;
+	port->UART->LCR = lcr;		/* DLAB = 0 */
 
-		//LPC_UART0->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART0 interrupt */
-		//LPC_UART0->IER =  IER_THRE ;//| IER_RLS;			/* Disable RBR */
+	UARTBaud[portNum] = baud;
+	return( TRUE );
+}
 
-		FreeRcv(0);
-		FreeSnd(0);
-		return (TRUE);
-	}
-	else if ( PortNum == 1 )
-	{
-		LPC_PINCON->PINSEL4 &= ~0x0000000F;
-		LPC_PINCON->PINSEL4 |= 0x0000000A;	/* Enable RxD1 P2.1, TxD1 P2.0 */
+/*****************************************************************************
+** Function name:		UARTInit
+**
+** Descriptions:		Initialize UART port, setup power, pin select,
+**						clock, parity, stop bits, FIFO, etc.
+**
+** parameters:			portNum(0 to 3) and UART baudrate
+** Returned value:		true or false, return false if the port number
+**						is out of range or the baud rate cannot be set
+**						within UART_BAUD_MAX_ERROR_PPM
+** 
+*****************************************************************************/
+uint32_t UARTInit( uint32_t PortNum, uint32_t baudrate )
+{
+	const UART_PORT *port;
 
-	/* By default, the PCLKSELx value is zero, thus, the PCLK for
-	all the peripherals is 1/4 of the SystemFrequency. */
-	/* Bit 8,9 are for UART1 */
-		pclk = getFrequency(8);
+	if ( PortNum >= UART_NUM_PORTS )
+		return( FALSE );
 
-		LPC_UART1->LCR = 0x83;		/* 8 bits, no Parity, 1 Stop bit */
+	port = &UARTPorts[PortNum];
 
-		Fdiv = ( pclk / 16 ) / baudrate ;	/*baud rate */
-		LPC_UART1->DLM = Fdiv / 256;					
-		LPC_UART1->DLL = Fdiv % 256;
+	LPC_SC->PCONP |= port->PCONPMask;	/* UART0/1 are powered at reset, UART2/3 are not */
 
-		LPC_UART1->LCR = 0x03;		/* DLAB = 0 */
-		LPC_UART1->FCR = 0x07;		/* Enable and reset TX and RX FIFO. */
+	*port->PINSEL &= ~port->PINSELMask;
+	*port->PINSEL |= port->PINSELValue;	/* route TxD and RxD to the port's pins */
 
-	 	NVIC_EnableIRQ(UART1_IRQn);
+	port->UART->LCR = 0x03;		/* 8 bits, no Parity, 1 Stop bit */
 
-		//LPC_UART1->IER = IER_RBR | IER_THRE | IER_RLS;	/* Enable UART1 interrupt */
+	if ( !UARTSetBaud( PortNum, baudrate ) )
+		return( FALSE );
 
-		FreeRcv(1);
-		FreeSnd(1);
+	port->UART->FCR = FCR_FIFO_EN | FCR_RX_RESET | FCR_TX_RESET | RX_TRIGGER_DEFAULT;	/* Enable and reset TX and RX FIFO. */
 
-		return (TRUE);
-	}
-	return( FALSE ); 
+	UARTTxHead[PortNum] = UARTTxTail[PortNum] = 0;
+	UARTRxHead[PortNum] = UARTRxTail[PortNum] = 0;
+	port->UART->IER = IER_RBR | IER_THRE | IER_RLS;	/* RBR fills the receive ring, THRE drains the transmit ring */
+
+	NVIC_EnableIRQ( port->IRQn );
+
+	FreeRcv(PortNum);
+	FreeSnd(PortNum);
+	return (TRUE);
 }
 
 /*****************************************************************************
-** Function name:		UARTSend
+** Function name:		UARTSendTimeout
 **
-** Descriptions:		Send a block of data to the UART 0 port based
-**						on the data length
+** Descriptions:		Copy a block of data into the transmit ring of a
+**						UART port and return. The THRE interrupt sends it
+**						one FIFO at a time. When the ring is full a thread
+**						blocks for up to timeout ticks (or WAIT_FOREVER)
+**						until the interrupt frees space. Before the kernel
+**						starts the caller spins instead, and an ISR never
+**						waits.
 **
-** parameters:			portNum, buffer pointer, and data length
-** Returned value:		None
+** parameters:			portNum, buffer pointer, data length and timeout
+** Returned value:		Number of bytes queued
 ** 
 *****************************************************************************/
-
-void UARTSend( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+uint32_t UARTSendTimeout( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length, int timeout )
 {
-	LPC_UART_TypeDef *LPC_UART;
-	volatile unsigned char *UARTTxEmpty;				//ASK Douglas
-	uint8_t *localBufferPtr;
-	uint32_t localLength;
+	uint32_t sent, head, state, deadline;
+	int remaining;
 
-	if((portNum >> 1 ) != 0)
-		return;
+	if ( portNum >= UART_NUM_PORTS )
+		return 0;
+
+	deadline = osGetTickCount() + timeout;
+	sent = 0;
+
+	/* One sender at a time so blocks from different threads are not interleaved */
+	while( LockSnd(portNum) ){
+		if ( !osCanBlock() )
+			return 0;
+		osYield();
+	}
+
+	while ( 1 ){
+		/* Copy as much as fits into the ring */
+		head = UARTTxHead[portNum];
+		while ( sent < Length && head - UARTTxTail[portNum] < TX_BUFSIZE ){
+			UARTTxBuffer[portNum][head & (TX_BUFSIZE - 1)] = BufferPtr[sent];
+			head++;
+			sent++;
+		}
+		UARTTxHead[portNum] = head;
 
-	localLength = Length;
-	localBufferPtr = BufferPtr;
-	UARTTxEmpty = (portNum == 0 ? &UART0TxEmpty : &UART1TxEmpty);
-	LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
+		/* Start the transmitter if it is idle, otherwise the next THRE interrupt picks the data up */
+		state = osEnterCritical();
+		UARTTxFill( portNum );
+		osExitCritical( state );
 
-	//Enable interupt
-	LPC_UART->IER |=  IER_THRE;
+		if ( sent == Length )
+			break;
 
-	while( LockSnd(portNum));
+		/* The ring is full */
+		if ( !osCanBlock() ){
+			if ( __get_IPSR() != 0 )
+				break;		/* an ISR never waits */
+			continue;		/* before the kernel starts, spin while the interrupt drains the ring */
+		}
+
+		remaining = WAIT_FOREVER;
+		if ( timeout != WAIT_FOREVER ){
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if ( remaining <= 0 )
+				break;
+		}
 
-	while ( localLength != 0 ){
-		/* THRE status, contain valid data */
-		while ( !(*UARTTxEmpty & 0x01) );
-		LPC_UART->THR = *localBufferPtr;
-		*UARTTxEmpty = 0;	/* not empty in the THR until it shifts out */
-		localBufferPtr++;
-		localLength--;
+		/* Block until the interrupt frees space, checking again with interrupts off so the wakeup is not missed */
+		state = osEnterCritical();
+		if ( UARTTxHead[portNum] - UARTTxTail[portNum] >= TX_BUFSIZE ){
+			UARTTxWaiter[portNum] = osGetRunningThread();
+			osBlockRunningThread( remaining );
+		}
+		osExitCritical( state );
+		osYield();
+		UARTTxWaiter[portNum] = EMPTY_INDEX;
 	}
 
 	FreeSnd(portNum);
+	return sent;
+}
 
-	//Reanble other interpts
-	LPC_UART->IER &= ~IER_THRE;
+/*****************************************************************************
+** Function name:		UARTSend
+**
+** Descriptions:		Send a block of data to a UART port based on the
+**						data length, waiting for ring space as long as
+**						needed
+**
+** parameters:			portNum, buffer pointer, and data length
+** Returned value:		None
+** 
+*****************************************************************************/
 
+void UARTSend( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+{
+	UARTSendTimeout( portNum, BufferPtr, Length, WAIT_FOREVER );
 	return;
 }
 
 void UARTSendChar( uint32_t portNum, uint8_t character)
 {
 	#ifdef __RTGT_UART
-		LPC_UART_TypeDef *LPC_UART;
-		LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
-		while (!(LPC_UART->LSR & 0x20));
-		LPC_UART->THR = character;
+		UARTSendTimeout( portNum, &character, 1, WAIT_FOREVER );
 	#else
 		ITM_SendChar(character);
 	#endif
@@ -335,71 +574,121 @@ void UARTSendChar( uint32_t portNum, uint8_t character)
 
 
 /*****************************************************************************
-** Function name:		UARTRecieve
+** Function name:		UARTSetRxTrigger
 **
-** Descriptions:		Recieve a block of data to the UART 0-1 port based
-**						on the data length
+** Descriptions:		Set how many bytes the RX FIFO collects before it
+**						raises an interrupt. Bytes below the trigger
+**						level are still delivered by the character
+**						time-out interrupt.
 **
-** parameters:			portNum, buffer pointer, and data length
-** Returned value:		integer showing status
+** parameters:			portNum and FCR_TRIGGER_1/4/8/14
+** Returned value:		None
 ** 
 *****************************************************************************/
-uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+void UARTSetRxTrigger( uint32_t portNum, uint8_t trigger )
 {
+	if ( portNum >= UART_NUM_PORTS )
+		return;
 
-	LPC_UART_TypeDef *LPC_UART;
-	volatile uint32_t *UARTCount;				//ASK Douglas
-	volatile uint8_t *UARTBuffer;
-	uint8_t *rcvdBufferPtr;
-	uint32_t rcvd_len, i;
+	UARTPorts[portNum].UART->FCR = FCR_FIFO_EN | (trigger & FCR_TRIGGER_14);	/* FCR is write only, keep the FIFOs enabled */
+}
+
+/*****************************************************************************
+** Function name:		UARTRecieveTimeout
+**
+** Descriptions:		Recieve a block of data from a UART 0-3 port.
+**						Returns as soon as at least one byte is in the
+**						receive ring, copying up to Length bytes. A thread
+**						sleeps until data arrives or timeout ticks (or
+**						WAIT_FOREVER) pass. Before the kernel starts the
+**						caller spins instead, and an ISR never waits.
+**
+** parameters:			portNum, buffer pointer, data length and timeout
+** Returned value:		Number of bytes received, 0 on timeout
+** 
+*****************************************************************************/
+uint32_t UARTRecieveTimeout( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length, int timeout )
+{
+	uint32_t rcvd_len, tail, state, deadline;
+	int remaining;
 
-	if((portNum >> 1 ) != 0)
+	if ( portNum >= UART_NUM_PORTS )
 		return 0;
 
+	deadline = osGetTickCount() + timeout;
 	rcvd_len = 0x0;
-	rcvdBufferPtr = BufferPtr;
-	UARTCount = (portNum == 0 ? &UART0Count : &UART1Count);
-	UARTBuffer = (portNum == 0 ? UART0Buffer : UART1Buffer);
-	LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
-
-	*UARTCount = 0x0;
-
-	//Enable interupt
-	LPC_UART->IER |=  IER_RBR;
-
-	//busy waiting
-
-	while( *UARTCount == 0 );
 
+	/* One reader at a time */
+	while( LockRcv(portNum) ){
+		if ( !osCanBlock() )
+			return 0;
+		osYield();
+	}
 
-	//This part has to be put in the critical section
-	while(LockRcv(portNum));
+	while ( 1 ){
+		/* Copy out whatever has arrived */
+		tail = UARTRxTail[portNum];
+		while ( rcvd_len < Length && tail != UARTRxHead[portNum] ){
+			BufferPtr[rcvd_len++] = UARTRxBuffer[portNum][tail & (RX_BUFSIZE - 1)];
+			tail++;
+		}
+		UARTRxTail[portNum] = tail;
 
-	//Reanble other interpts
-	LPC_UART->IER &= ~IER_RBR;			/* Disable RBR */
+		if ( rcvd_len != 0 || Length == 0 )
+			break;
 
+		/* Nothing yet */
+		if ( !osCanBlock() ){
+			if ( __get_IPSR() != 0 )
+				break;		/* an ISR never waits */
+			continue;		/* before the kernel starts, spin while the interrupt fills the ring */
+		}
 
-	for(i = 0; i < *UARTCount; ++i)
-		rcvdBufferPtr[rcvd_len++] = UARTBuffer[i];
+		remaining = WAIT_FOREVER;
+		if ( timeout != WAIT_FOREVER ){
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if ( remaining <= 0 )
+				break;
+		}
 
-	*UARTCount = 0;
+		/* Sleep until the interrupt delivers data, checking again with interrupts off so the wakeup is not missed */
+		state = osEnterCritical();
+		if ( UARTRxHead[portNum] == UARTRxTail[portNum] ){
+			UARTRxWaiter[portNum] = osGetRunningThread();
+			osBlockRunningThread( remaining );
+		}
+		osExitCritical( state );
+		osYield();
+		UARTRxWaiter[portNum] = EMPTY_INDEX;
+	}
 
 	FreeRcv(portNum);
 
 	return rcvd_len;
 }
 
+/*****************************************************************************
+** Function name:		UARTRecieve
+**
+** Descriptions:		Recieve a block of data from a UART 0-3 port,
+**						waiting as long as needed for the first byte
+**
+** parameters:			portNum, buffer pointer, and data length
+** Returned value:		Number of bytes received
+** 
+*****************************************************************************/
+uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length )
+{
+	return UARTRecieveTimeout( portNum, BufferPtr, Length, WAIT_FOREVER );
+}
+
 uint8_t UARTReceiveChar( uint32_t portNum)
 {
 	#ifdef __RTGT_UART
-		/*uint8_t ret[1];
+		uint8_t ret[1];
 		if (UARTRecieve(portNum, ret, 1) == 1)
 			return ret[0];
-		return 0x0;	*/
-		LPC_UART_TypeDef *LPC_UART;
-		LPC_UART = (portNum == 0 ? (LPC_UART_TypeDef *)LPC_UART0 : (LPC_UART_TypeDef *)LPC_UART1 );
-		while (!(LPC_UART->LSR & 0x01));
-		return (LPC_UART->RBR);
+		return 0x0;
 	#else
 		while (ITM_CheckChar() != 1) __NOP();
 		return (ITM_ReceiveChar());
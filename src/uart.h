@@ -21,6 +21,9 @@
 #define __UART_H
 
 #include <stdint.h>
+#include "lpc17xx.h"
+
+#define UART_NUM_PORTS	4	/* UART0 to UART3 */
 
 #define IER_RBR		0x01
 #define IER_THRE	0x02
@@ -43,6 +46,21 @@
 
 #define BUFSIZE		0x40
 
+#define RX_BUFSIZE	0x100	/* size of the receive ring, must be a power of 2 */
+
+#define FCR_FIFO_EN	0x01
+#define FCR_RX_RESET	0x02
+#define FCR_TX_RESET	0x04
+#define FCR_TRIGGER_1	0x00	/* RX interrupt after 1 byte */
+#define FCR_TRIGGER_4	0x40	/* RX interrupt after 4 bytes */
+#define FCR_TRIGGER_8	0x80	/* RX interrupt after 8 bytes */
+#define FCR_TRIGGER_14	0xC0	/* RX interrupt after 14 bytes */
+
+#define RX_TRIGGER_DEFAULT	FCR_TRIGGER_8	/* bytes below the trigger level are flushed by the character timeout */
+
+#define TX_BUFSIZE	0x100	/* size of the transmit ring, must be a power of 2 */
+#define TX_FIFO_SIZE	16	/* depth of the UART transmit FIFO */
+
 #ifndef FALSE
 #define FALSE   (0)
 #endif
@@ -51,14 +69,54 @@
 #define TRUE    (1)
 #endif
 
+/* Compile time description of one UART port */
+typedef struct
+{
+	LPC_UART_TypeDef *UART;		/* register block */
+	IRQn_Type IRQn;				/* NVIC interrupt */
+	volatile uint32_t *PCLKSEL;	/* PCLKSEL register holding the port's clock divider */
+	uint8_t PCLKShift;			/* position of the divider bits in PCLKSEL */
+	uint32_t PCONPMask;			/* power control bit */
+	volatile uint32_t *PINSEL;	/* PINSEL register routing TxD and RxD */
+	uint32_t PINSELMask;		/* PINSEL bits of the two pins */
+	uint32_t PINSELValue;		/* PINSEL value selecting the UART function */
+} UART_PORT;
+
+extern const UART_PORT UARTPorts[UART_NUM_PORTS];
+
+/* The UART PCLK is set at build time by PCLKSELx_Val in system_LPC17xx.c, CCLK by default.
+   With the fractional divider (divisor at least 3) the standard rates up to 1.5 Mbaud fit at 100 MHz,
+   above that only PCLK / (16 * divisor) is reachable: 6.25, 3.125, 2.083 ... Mbaud at 100 MHz.
+   A PCLK of CCLK / 4 stops at 460800, 921600 is then 15% off and refused. */
+#define UART_BAUD_MAX_ERROR_PPM	20000	/* largest baud error UARTSetBaud accepts (2%) */
+
+/* Divider setting chosen for a baud rate, baud = PCLK * mulVal / (16 * divisor * (mulVal + divAddVal)) */
+typedef struct
+{
+	uint32_t pclkSel;		/* PCLKSEL code, 0 = CCLK/4, 1 = CCLK, 2 = CCLK/2, 3 = CCLK/8 */
+	uint32_t divisor;		/* DLM:DLL divisor latch */
+	uint32_t divAddVal;		/* FDR DIVADDVAL, 0 turns the fractional divider off */
+	uint32_t mulVal;		/* FDR MULVAL */
+	uint32_t actual;		/* achieved baud rate */
+	int32_t errorPPM;		/* error of the achieved rate in parts per million */
+} UART_BAUD;
+
+extern UART_BAUD UARTBaud[UART_NUM_PORTS];
 
 void UART0_IRQHandler( void );
 void UART1_IRQHandler( void );
+void UART2_IRQHandler( void );
+void UART3_IRQHandler( void );
 
 uint32_t UARTInit( uint32_t portNum, uint32_t Baudrate );
+uint32_t UARTSetBaud( uint32_t portNum, uint32_t Baudrate );
+uint32_t UARTBaudSearch( uint32_t Baudrate, uint32_t pclkMask, UART_BAUD *baud );
 
 void     UARTSend(    uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
+uint32_t UARTSendTimeout( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length, int timeout );
 uint32_t UARTRecieve( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length );
+uint32_t UARTRecieveTimeout( uint32_t portNum, uint8_t *BufferPtr, uint32_t Length, int timeout );
+void     UARTSetRxTrigger( uint32_t portNum, uint8_t trigger );
 
 void     UARTSendChar(    uint32_t portNum, uint8_t character );
 uint8_t  UARTReceiveChar( uint32_t portNum );
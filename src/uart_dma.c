@@ -0,0 +1,343 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_dma.c
+ * Purpose: GPDMA backed UART transfers for high rate serial I/O on UART0 to UART3
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for uart, uart_dma, and _kernelCore
+#include "string.h"
+#include "uart.h"
+#include "uart_dma.h"
+#include "_kernelCore.h"
+#include "_cpuAPI.h"
+
+//GPDMA channel control word fields
+#define DMA_CONTROL_SIZE(n) ((n) & 0xFFF) //Number of transfers
+#define DMA_CONTROL_SI (1U << 26) //Increment the source address
+#define DMA_CONTROL_DI (1U << 27) //Increment the destination address
+#define DMA_CONTROL_I (1U << 31) //Raise the terminal count interrupt when this descriptor finishes
+
+//GPDMA channel config fields
+#define DMA_CONFIG_E (1U << 0) //Enable the channel
+#define DMA_CONFIG_SRC(req) ((req) << 1) //Source peripheral request line
+#define DMA_CONFIG_DEST(req) ((req) << 6) //Destination peripheral request line
+#define DMA_CONFIG_M2P (1U << 11) //Memory to peripheral
+#define DMA_CONFIG_P2M (2U << 11) //Peripheral to memory
+#define DMA_CONFIG_IE (1U << 14) //Unmask the error interrupt
+#define DMA_CONFIG_ITC (1U << 15) //Unmask the terminal count interrupt
+
+//UART request lines run from 8 (UART0 TX) and 9 (UART0 RX) up to 14 (UART3 TX) and 15 (UART3 RX)
+//DMAREQSEL resets to picking the UARTs over the timer matches on these lines
+#define DMA_TX_REQUEST(portNum) (8 + 2 * (portNum))
+#define DMA_RX_REQUEST(portNum) (9 + 2 * (portNum))
+
+//Each port uses two channels, the even one transmits and the odd one receives, so four ports use all eight
+#define DMA_TX_CHANNEL(portNum) (2 * (portNum))
+#define DMA_RX_CHANNEL(portNum) (2 * (portNum) + 1)
+
+//FCR bit that lets the UART FIFOs raise GPDMA requests
+#define FCR_DMA_MODE 0x08
+
+//Power control bit for the GPDMA
+#define PCONP_PCGPDMA (1U << 29)
+
+//Descriptors and buffers for every port, placed at the start of the AHB SRAM bank
+uartDMAPortRAM uartDMARAM[UART_NUM_PORTS] UART_DMA_RAM_AT(UART_DMA_RAM_BASE);
+
+//Driver state for every port
+uartDMAState uartDMAStates[UART_NUM_PORTS];
+
+//Load the first descriptor of a linked list into a channel and enable it
+void uartDMAStart(int channel, uartDMALLI* lli, uint32_t config)
+{
+	LPC_GPDMACH_TypeDef* dmaChannel = UART_DMA_CHANNEL(channel);
+
+	UART_DMA_CONTROLLER->DMACIntTCClear = 1U << channel; //Clear anything left over from the last transfer
+	UART_DMA_CONTROLLER->DMACIntErrClr = 1U << channel;
+
+	dmaChannel->DMACCSrcAddr = lli->source;
+	dmaChannel->DMACCDestAddr = lli->destination;
+	dmaChannel->DMACCLLI = lli->next;
+	dmaChannel->DMACCControl = lli->control;
+	dmaChannel->DMACCConfig = config | DMA_CONFIG_E;
+}
+
+//Set up the GPDMA channels for a UART port (0 to 3) that UARTInit has already configured, returns false for an invalid port
+bool UARTDMAInit(uint32_t portNum)
+{
+	if (portNum >= UART_NUM_PORTS)
+	{
+		return false;
+	}
+
+	LPC_UART_TypeDef* uart = UART_DMA_UART(portNum);
+	uartDMAPortRAM* ram = &uartDMARAM[portNum];
+	uartDMAState* state = &uartDMAStates[portNum];
+
+	//Power and enable the controller the first time any port is set up
+	if (!(UART_DMA_CONTROLLER->DMACConfig & 1))
+	{
+		LPC_SC->PCONP |= PCONP_PCGPDMA;
+		UART_DMA_CONTROLLER->DMACConfig = 1; //Enable the controller, little endian
+		NVIC_EnableIRQ(DMA_IRQn);
+	}
+
+	//The GPDMA now moves the data, so stop the interrupt driven rings (line status errors are still reported)
+	uart->IER = IER_RLS;
+	uart->FCR = FCR_FIFO_EN | FCR_RX_RESET | FCR_TX_RESET | FCR_DMA_MODE | FCR_TRIGGER_1;
+
+	state->txBusy = false;
+	state->txError = false;
+	state->rxError = false;
+	state->txWaiter = EMPTY_INDEX;
+	state->rxWaiter = EMPTY_INDEX;
+	state->rxRead = 0;
+
+	//The receive list loops between the two halves forever, raising an interrupt each time a half fills
+	for (int i = 0; i < 2; i++)
+	{
+		ram->rxLLI[i].source = (uint32_t)&uart->RBR;
+		ram->rxLLI[i].destination = (uint32_t)&ram->rxBuffer[i * UART_DMA_RX_HALF];
+		ram->rxLLI[i].next = (uint32_t)&ram->rxLLI[1 - i];
+		ram->rxLLI[i].control = DMA_CONTROL_SIZE(UART_DMA_RX_HALF) | DMA_CONTROL_DI | DMA_CONTROL_I;
+	}
+	uartDMAStart(DMA_RX_CHANNEL(portNum), &ram->rxLLI[0], DMA_CONFIG_SRC(DMA_RX_REQUEST(portNum)) | DMA_CONFIG_P2M | DMA_CONFIG_IE | DMA_CONFIG_ITC);
+
+	state->initialised = true;
+	return true;
+}
+
+//Wait until the transmit channel of a port is idle, returns false if the timeout ran out first
+bool uartDMAWaitTx(uint32_t portNum, uint32_t deadline, int timeout)
+{
+	uartDMAState* dmaState = &uartDMAStates[portNum];
+
+	while (dmaState->txBusy)
+	{
+		//Threads block, anything else can only poll
+		if (!osCanBlock())
+		{
+			if (timeout == 0 || __get_IPSR() != 0)
+			{
+				return false;
+			}
+			continue; //Before the kernel starts, spin while the transfer finishes
+		}
+
+		int remaining = WAIT_FOREVER;
+		if (timeout != WAIT_FOREVER)
+		{
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if (remaining <= 0)
+			{
+				return false;
+			}
+		}
+
+		//Block until the GPDMA interrupt reports the end of the transfer
+		uint32_t state = osEnterCritical();
+		if (dmaState->txBusy)
+		{
+			dmaState->txWaiter = osGetRunningThread();
+			osBlockRunningThread(remaining);
+		}
+		osExitCritical(state);
+		osYield(); //Yield
+		dmaState->txWaiter = EMPTY_INDEX;
+	}
+	return true;
+}
+
+//Send a block of data with the GPDMA and wait up to timeout ticks (or WAIT_FOREVER) for it to finish
+bool UARTDMASend(uint32_t portNum, uint8_t* buffer, uint32_t length, int timeout)
+{
+	if (portNum >= UART_NUM_PORTS || !uartDMAStates[portNum].initialised)
+	{
+		return false;
+	}
+
+	LPC_UART_TypeDef* uart = UART_DMA_UART(portNum);
+	uartDMAPortRAM* ram = &uartDMARAM[portNum];
+	uint32_t deadline = osGetTickCount() + timeout; //Tick count at which the send times out
+	uint32_t sent = 0; //Number of bytes handed to the GPDMA
+
+	while (sent < length)
+	{
+		//Only one transfer per port can be in flight, and the staging buffer and descriptors belong to it
+		//With a timeout of 0 the earlier parts still have to finish, only the wait for the last part is skipped
+		if (!uartDMAWaitTx(portNum, deadline, (timeout == 0) ? WAIT_FOREVER : timeout))
+		{
+			return false;
+		}
+
+		uint8_t* source; //Where the GPDMA reads this part from
+		uint32_t count; //Number of bytes in this part
+
+		if (UART_DMA_REACHABLE(buffer + sent, length - sent))
+		{
+			//Send straight from the caller's buffer, chained over as many descriptors as needed
+			source = buffer + sent;
+			count = length - sent;
+			if (count > UART_DMA_MAX_LLI * UART_DMA_MAX_CHUNK)
+			{
+				count = UART_DMA_MAX_LLI * UART_DMA_MAX_CHUNK;
+			}
+		}
+		else
+		{
+			//Copy into the staging buffer first
+			source = ram->txBuffer;
+			count = length - sent;
+			if (count > UART_DMA_TX_BUFSIZE)
+			{
+				count = UART_DMA_TX_BUFSIZE;
+			}
+			memcpy(ram->txBuffer, buffer + sent, count);
+		}
+
+		//Build the linked list, only the last descriptor raises the terminal count interrupt
+		int numLLI = 0;
+		for (uint32_t offset = 0; offset < count; offset += UART_DMA_MAX_CHUNK)
+		{
+			uint32_t chunk = (count - offset > UART_DMA_MAX_CHUNK) ? UART_DMA_MAX_CHUNK : count - offset;
+			ram->txLLI[numLLI].source = (uint32_t)(source + offset);
+			ram->txLLI[numLLI].destination = (uint32_t)&uart->THR;
+			ram->txLLI[numLLI].next = 0;
+			ram->txLLI[numLLI].control = DMA_CONTROL_SIZE(chunk) | DMA_CONTROL_SI;
+			if (numLLI > 0)
+			{
+				ram->txLLI[numLLI - 1].next = (uint32_t)&ram->txLLI[numLLI];
+			}
+			numLLI++;
+		}
+		ram->txLLI[numLLI - 1].control |= DMA_CONTROL_I;
+
+		uartDMAStates[portNum].txError = false;
+		uartDMAStates[portNum].txBusy = true;
+		uartDMAStart(DMA_TX_CHANNEL(portNum), &ram->txLLI[0], DMA_CONFIG_DEST(DMA_TX_REQUEST(portNum)) | DMA_CONFIG_M2P | DMA_CONFIG_IE | DMA_CONFIG_ITC);
+
+		sent += count;
+	}
+
+	//Wait for the last part to finish, unless the caller only wanted to start the transfer
+	if (timeout == 0)
+	{
+		return !uartDMAStates[portNum].txBusy;
+	}
+	return uartDMAWaitTx(portNum, deadline, timeout) && !uartDMAStates[portNum].txError;
+}
+
+//Returns the offset in the ping-pong buffer of the next byte the GPDMA will write
+uint32_t uartDMARxPosition(uint32_t portNum)
+{
+	//The channel's destination address always points at the next byte it will write
+	uint32_t write = UART_DMA_CHANNEL(DMA_RX_CHANNEL(portNum))->DMACCDestAddr - (uint32_t)uartDMARAM[portNum].rxBuffer;
+	if (write >= 2 * UART_DMA_RX_HALF)
+	{
+		write = 0; //The channel is about to load the first descriptor again
+	}
+	return write;
+}
+
+//Receive up to length bytes that the GPDMA has written into the ping-pong buffer
+//Bytes that fill less than half the buffer are picked up when the wait times out or the next call is made
+uint32_t UARTDMARecieve(uint32_t portNum, uint8_t* buffer, uint32_t length, int timeout)
+{
+	if (portNum >= UART_NUM_PORTS || !uartDMAStates[portNum].initialised)
+	{
+		return 0;
+	}
+
+	uartDMAState* dmaState = &uartDMAStates[portNum];
+	uint8_t* rxBuffer = uartDMARAM[portNum].rxBuffer;
+	uint32_t deadline = osGetTickCount() + timeout; //Tick count at which the receive times out
+	uint32_t received = 0; //Number of bytes copied to the caller
+
+	while (1)
+	{
+		uint32_t write = uartDMARxPosition(portNum); //Position of the next byte the GPDMA will write
+
+		//Copy everything between the read and write positions
+		while (received < length && dmaState->rxRead != write)
+		{
+			buffer[received++] = rxBuffer[dmaState->rxRead];
+			dmaState->rxRead++;
+			if (dmaState->rxRead >= 2 * UART_DMA_RX_HALF)
+			{
+				dmaState->rxRead = 0;
+			}
+		}
+
+		if (received != 0 || length == 0 || timeout == 0 || !osCanBlock())
+		{
+			return received;
+		}
+
+		int remaining = WAIT_FOREVER;
+		if (timeout != WAIT_FOREVER)
+		{
+			remaining = (int32_t)(deadline - osGetTickCount());
+			if (remaining <= 0)
+			{
+				return received;
+			}
+		}
+
+		//Block until a half fills or the timeout runs out, then look again
+		//The position is checked again with interrupts off so a half that fills right now is not missed
+		uint32_t state = osEnterCritical();
+		if (uartDMARxPosition(portNum) == dmaState->rxRead)
+		{
+			dmaState->rxWaiter = osGetRunningThread();
+			osBlockRunningThread(remaining);
+		}
+		osExitCritical(state);
+		osYield(); //Yield
+		dmaState->rxWaiter = EMPTY_INDEX;
+	}
+}
+
+//GPDMA interrupt handler
+void DMA_IRQHandler(void)
+{
+	osISREnter(); //Time in the handler is not charged to the interrupted thread
+
+	uint32_t terminalCount = UART_DMA_CONTROLLER->DMACIntTCStat; //Channels that finished a descriptor with the I bit set
+	uint32_t error = UART_DMA_CONTROLLER->DMACIntErrStat; //Channels that stopped on a bus error
+
+	UART_DMA_CONTROLLER->DMACIntTCClear = terminalCount;
+	UART_DMA_CONTROLLER->DMACIntErrClr = error;
+
+	for (uint32_t portNum = 0; portNum < UART_NUM_PORTS; portNum++)
+	{
+		uartDMAState* dmaState = &uartDMAStates[portNum];
+		uint32_t txMask = 1U << DMA_TX_CHANNEL(portNum);
+		uint32_t rxMask = 1U << DMA_RX_CHANNEL(portNum);
+
+		//A transmit finished, let the next one start
+		if ((terminalCount | error) & txMask)
+		{
+			dmaState->txError = (error & txMask) != 0;
+			dmaState->txBusy = false;
+			if (dmaState->txWaiter != EMPTY_INDEX)
+			{
+				osWakeThread(dmaState->txWaiter);
+			}
+		}
+
+		//A receive half filled (or the channel stopped), let the reader copy it out
+		if ((terminalCount | error) & rxMask)
+		{
+			if (error & rxMask)
+			{
+				dmaState->rxError = true;
+			}
+			if (dmaState->rxWaiter != EMPTY_INDEX)
+			{
+				osWakeThread(dmaState->rxWaiter);
+			}
+		}
+	}
+
+	osISRExit();
+}
@@ -0,0 +1,101 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_dma.h
+ * Purpose: GPDMA backed UART transfers for high rate serial I/O on UART0 to UART3
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for uart_dma
+#ifndef _uart_dma
+#define _uart_dma
+
+#include "osDefs.h"
+#include "uart.h"
+
+//Start of the AHB SRAM bank (IRAM2 in the project), the GPDMA cannot reach the CPU local SRAM at 0x10000000
+#define UART_DMA_RAM_BASE 0x2007C000
+#define UART_DMA_RAM_SIZE 0x8000
+
+//The driver keeps its descriptors and buffers at the start of the bank, callers can place their own buffers after it
+#define UART_DMA_DRIVER_RAM_SIZE 0x3000
+#define UART_DMA_USER_BASE (UART_DMA_RAM_BASE + UART_DMA_DRIVER_RAM_SIZE)
+
+//Place a variable in the AHB SRAM bank so the GPDMA can reach it
+//With the ARM compiler the linker puts it at the given address without needing a scatter file
+//With GCC the linker script has to map the .ahbsram section to the bank
+#if defined(__CC_ARM)
+	#define UART_DMA_RAM_AT(address) __attribute__((at(address), zero_init))
+#else
+	#define UART_DMA_RAM_AT(address) __attribute__((section(".ahbsram")))
+#endif
+
+//Place a caller buffer offset bytes into the part of the bank the driver does not use
+#define UART_DMA_USER_RAM(offset) UART_DMA_RAM_AT(UART_DMA_USER_BASE + (offset))
+
+//Returns whether a buffer lies in memory the GPDMA can reach
+#define UART_DMA_REACHABLE(ptr, len) ((uint32_t)(ptr) >= UART_DMA_RAM_BASE && (uint32_t)(ptr) + (len) <= UART_DMA_RAM_BASE + UART_DMA_RAM_SIZE)
+
+//Define buffer sizes
+#define UART_DMA_TX_BUFSIZE 0x800 //Staging buffer for data that has to be copied before the GPDMA can send it
+#define UART_DMA_RX_HALF 0x100 //Size of each half of the ping-pong receive buffer
+#define UART_DMA_MAX_LLI 4 //Linked list descriptors per transmit, each one moves up to UART_DMA_MAX_CHUNK bytes
+#define UART_DMA_MAX_CHUNK 0xFFF //Largest transfer size of one GPDMA descriptor
+
+//Register blocks used by the driver
+//They are macros so an off-target build can point them at fake register blocks (port/posix/fake does for uart_dma_test)
+#ifndef UART_DMA_UART
+	#define UART_DMA_UART(portNum) (UARTPorts[portNum].UART)
+#endif
+#ifndef UART_DMA_CHANNEL
+	#define UART_DMA_CHANNEL(channel) ((LPC_GPDMACH_TypeDef *)((uint32_t)LPC_GPDMACH0 + (channel) * 0x20))
+#endif
+#ifndef UART_DMA_CONTROLLER
+	#define UART_DMA_CONTROLLER LPC_GPDMA
+#endif
+
+//Define GPDMA linked list descriptor, the layout is fixed by the hardware
+typedef struct uart_dma_lli_struct
+{
+	uint32_t source; //Source address
+	uint32_t destination; //Destination address
+	uint32_t next; //Address of the next descriptor (0 for the last one)
+	uint32_t control; //Channel control word for this descriptor
+}uartDMALLI;
+
+//Define the descriptors and buffers of one port, these have to be in AHB SRAM
+typedef struct uart_dma_port_ram_struct
+{
+	uartDMALLI txLLI[UART_DMA_MAX_LLI]; //Linked list for the transmit in progress
+	uartDMALLI rxLLI[2]; //Circular linked list that alternates between the ping and pong halves
+	uint8_t txBuffer[UART_DMA_TX_BUFSIZE]; //Staging buffer for data that the GPDMA cannot reach
+	uint8_t rxBuffer[2 * UART_DMA_RX_HALF]; //Ping-pong receive buffer
+}uartDMAPortRAM;
+
+//Define the driver state of one port, kept in normal RAM
+typedef struct uart_dma_state_struct
+{
+	bool initialised; //Whether UARTDMAInit has been called for the port
+	volatile bool txBusy; //Whether a transmit is in progress
+	volatile bool txError; //Whether the last transmit ended with a bus error
+	volatile bool rxError; //Whether the receive channel stopped with a bus error
+	volatile int txWaiter; //Thread blocked until the transmit finishes (EMPTY_INDEX if none)
+	volatile int rxWaiter; //Thread blocked until a receive half fills (EMPTY_INDEX if none)
+	uint32_t rxRead; //Offset in the ping-pong buffer of the next byte to hand to the reader
+}uartDMAState;
+
+//Set up the GPDMA channels for a UART port (0 to 3) that UARTInit has already configured, returns false for an invalid port
+//The port stops using its interrupt driven transmit and receive rings
+bool UARTDMAInit(uint32_t portNum);
+
+//Send a block of data with the GPDMA and wait up to timeout ticks (or WAIT_FOREVER) for it to finish
+//Data outside AHB SRAM is copied into the staging buffer first, data in AHB SRAM is sent without a copy
+//A timeout of 0 returns as soon as the last part has been started, returns false if the transfer had not finished
+bool UARTDMASend(uint32_t portNum, uint8_t* buffer, uint32_t length, int timeout);
+
+//Receive up to length bytes that the GPDMA has written into the ping-pong buffer
+//Waits up to timeout ticks (or WAIT_FOREVER) for a half of the buffer to fill if nothing has arrived, returns the number of bytes copied
+uint32_t UARTDMARecieve(uint32_t portNum, uint8_t* buffer, uint32_t length, int timeout);
+
+//GPDMA interrupt handler
+void DMA_IRQHandler(void);
+
+#endif
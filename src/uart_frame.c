@@ -0,0 +1,298 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_frame.c
+ * Purpose: COBS framed packets with CRC-16 and per-channel sequence numbers over the UART ports
+ *----------------------------------------------------------------------------
+*/
+
+//Include header file for uart, uart_frame, and _kernelCore
+#include "uart.h"
+#include "uart_frame.h"
+#include "_kernelCore.h"
+
+//Receive state of every port
+uartFrameRx uartFrameRxStates[UART_NUM_PORTS];
+
+//Sequence number sent next on each channel of each port
+uint8_t uartFrameTxSequence[UART_NUM_PORTS][FRAME_MAX_CHANNELS];
+
+//Lock held while a frame is sent so frames from different threads are not interleaved
+volatile uint8_t uartFrameTxLock[UART_NUM_PORTS];
+
+//Spin lock helpers from uart.c
+extern uint8_t Lock(volatile uint8_t* tbl);
+extern void Free(volatile uint8_t* tbl);
+
+//CRC-16/CCITT-FALSE (polynomial 0x1021) of every 4-bit value, a 16 entry table keeps the flash cost small
+const uint16_t frameCRCTable[16] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+//Returns the CRC-16/CCITT-FALSE of a buffer continuing from crc (start with 0xFFFF)
+uint16_t frameCRC16(uint16_t crc, const uint8_t* data, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; i++)
+	{
+		crc = (crc << 4) ^ frameCRCTable[(crc >> 12) ^ (data[i] >> 4)];
+		crc = (crc << 4) ^ frameCRCTable[(crc >> 12) ^ (data[i] & 0x0F)];
+	}
+	return crc;
+}
+
+//Returns whether the cursor has read every piece
+bool frameCursorDone(uartFrameCursor* cursor)
+{
+	//Skip over empty or finished pieces
+	while (cursor->piece < 3 && cursor->position >= cursor->length[cursor->piece])
+	{
+		cursor->piece++;
+		cursor->position = 0;
+	}
+	return cursor->piece >= 3;
+}
+
+//Returns the number of non-zero bytes (at most COBS_MAX_RUN) starting at the cursor, without moving it
+uint32_t frameCursorRun(uartFrameCursor* cursor)
+{
+	int piece = cursor->piece;
+	uint32_t position = cursor->position;
+	uint32_t run = 0;
+
+	while (piece < 3 && run < COBS_MAX_RUN)
+	{
+		if (position >= cursor->length[piece])
+		{
+			piece++;
+			position = 0;
+			continue;
+		}
+		if (cursor->data[piece][position] == 0)
+		{
+			break;
+		}
+		position++;
+		run++;
+	}
+	return run;
+}
+
+//Send count bytes from the cursor to the UART a piece at a time and move past them
+void frameCursorSend(uint32_t portNum, uartFrameCursor* cursor, uint32_t count)
+{
+	while (count > 0 && !frameCursorDone(cursor))
+	{
+		uint32_t part = cursor->length[cursor->piece] - cursor->position;
+		if (part > count)
+		{
+			part = count;
+		}
+		UARTSendTimeout(portNum, (uint8_t*)&cursor->data[cursor->piece][cursor->position], part, WAIT_FOREVER);
+		cursor->position += part;
+		count -= part;
+	}
+}
+
+//Send a payload as one frame on a channel of a UART port that UARTInit has set up
+bool UARTFrameSend(uint32_t portNum, uint8_t channel, const uint8_t* payload, uint32_t length)
+{
+	if (portNum >= UART_NUM_PORTS || channel >= FRAME_MAX_CHANNELS || length > FRAME_MAX_PAYLOAD)
+	{
+		return false;
+	}
+
+	//One frame at a time per port
+	while (Lock(&uartFrameTxLock[portNum]))
+	{
+		if (!osCanBlock())
+		{
+			return false; //An ISR cannot wait for the thread holding the lock
+		}
+		osYield();
+	}
+
+	uint8_t header[FRAME_HEADER_SIZE] = {channel, uartFrameTxSequence[portNum][channel]++};
+	uint16_t crc = frameCRC16(frameCRC16(0xFFFF, header, FRAME_HEADER_SIZE), payload, length);
+	uint8_t trailer[FRAME_CRC_SIZE] = {crc & 0xFF, crc >> 8};
+	uartFrameCursor cursor = {{header, payload, trailer}, {FRAME_HEADER_SIZE, length, FRAME_CRC_SIZE}, 0, 0};
+	uint8_t code;
+
+	//COBS: each block is a code byte holding the run length plus one, then the run, and the zero after the run is implied
+	//A run of COBS_MAX_RUN bytes has no implied zero, and the data always ends with one more block
+	while (1)
+	{
+		uint32_t run = frameCursorRun(&cursor);
+		code = run + 1;
+		UARTSendTimeout(portNum, &code, 1, WAIT_FOREVER);
+		frameCursorSend(portNum, &cursor, run);
+
+		if (run == COBS_MAX_RUN)
+		{
+			continue; //No zero to skip, the next block carries on
+		}
+		if (frameCursorDone(&cursor))
+		{
+			break;
+		}
+		cursor.position++; //Skip the zero the code byte stands for
+	}
+
+	//End the frame
+	code = 0;
+	UARTSendTimeout(portNum, &code, 1, WAIT_FOREVER);
+
+	Free(&uartFrameTxLock[portNum]);
+	return true;
+}
+
+//Decode a COBS block in place, returns the decoded length or -1 if the encoding is broken
+int frameDecodeCOBS(uint8_t* data, uint32_t length)
+{
+	uint32_t read = 0; //Next encoded byte
+	uint32_t write = 0; //Next decoded byte, never ahead of read so the data can be decoded in place
+
+	while (read < length)
+	{
+		uint32_t code = data[read++];
+		if (code == 0 || read + code - 1 > length)
+		{
+			return -1;
+		}
+		for (uint32_t i = 1; i < code; i++)
+		{
+			data[write++] = data[read++];
+		}
+		//Every block but the last and the full length ones stands for a zero
+		if (code != COBS_MAX_RUN + 1 && read < length)
+		{
+			data[write++] = 0;
+		}
+	}
+	return write;
+}
+
+//Check a received frame and copy its payload out, returns the payload length or -1 if the frame is dropped
+int frameAccept(uartFrameRx* rx, uint8_t* channel, uint8_t* buffer, uint32_t size)
+{
+	int length = frameDecodeCOBS(rx->encoded, rx->encodedLength);
+
+	//A frame needs at least a header and a CRC, and the CRC has to match everything before it
+	if (length < FRAME_HEADER_SIZE + FRAME_CRC_SIZE)
+	{
+		rx->stats.crcErrors++;
+		return -1;
+	}
+	uint16_t crc = frameCRC16(0xFFFF, rx->encoded, length - FRAME_CRC_SIZE);
+	if (rx->encoded[length - 2] != (crc & 0xFF) || rx->encoded[length - 1] != (crc >> 8) || rx->encoded[0] >= FRAME_MAX_CHANNELS)
+	{
+		rx->stats.crcErrors++;
+		return -1;
+	}
+
+	uint8_t frameChannel = rx->encoded[0];
+	uint8_t sequence = rx->encoded[1];
+	uint32_t payloadLength = length - FRAME_HEADER_SIZE - FRAME_CRC_SIZE;
+
+	//Count the frames skipped since the last one on this channel
+	if (rx->synced[frameChannel])
+	{
+		rx->stats.lost += (uint8_t)(sequence - rx->nextSequence[frameChannel]);
+	}
+	rx->synced[frameChannel] = true;
+	rx->nextSequence[frameChannel] = sequence + 1;
+
+	if (payloadLength > size)
+	{
+		rx->stats.overruns++;
+		return -1;
+	}
+
+	for (uint32_t i = 0; i < payloadLength; i++)
+	{
+		buffer[i] = rx->encoded[FRAME_HEADER_SIZE + i];
+	}
+	*channel = frameChannel;
+	rx->stats.received++;
+	return payloadLength;
+}
+
+//Receive the next valid frame on a UART port, waiting up to timeout ticks (or WAIT_FOREVER)
+int UARTFrameRecieve(uint32_t portNum, uint8_t* channel, uint8_t* buffer, uint32_t size, int timeout)
+{
+	if (portNum >= UART_NUM_PORTS)
+	{
+		return -1;
+	}
+
+	uartFrameRx* rx = &uartFrameRxStates[portNum];
+	uint32_t deadline = osGetTickCount() + timeout; //Tick count at which the wait times out
+
+	while (1)
+	{
+		//Read more bytes once the last chunk has been looked at, a partial frame is kept for the next call on timeout
+		if (rx->rawStart == rx->rawEnd)
+		{
+			int remaining = timeout;
+			if (timeout != WAIT_FOREVER)
+			{
+				remaining = (int32_t)(deadline - osGetTickCount());
+				if (remaining < 0)
+				{
+					return -1;
+				}
+			}
+			rx->rawStart = 0;
+			rx->rawEnd = UARTRecieveTimeout(portNum, rx->raw, FRAME_RAW_SIZE, remaining);
+			if (rx->rawEnd == 0)
+			{
+				return -1; //Return -1 on timeout
+			}
+		}
+
+		//Collect bytes until the zero that ends the frame
+		while (rx->rawStart < rx->rawEnd)
+		{
+			uint8_t data = rx->raw[rx->rawStart++];
+
+			if (data != 0)
+			{
+				if (rx->encodedLength < FRAME_MAX_ENCODED)
+				{
+					rx->encoded[rx->encodedLength++] = data;
+				}
+				else
+				{
+					rx->overrun = true;
+				}
+				continue;
+			}
+
+			//A zero ends the frame, start collecting the next one whatever happens to this one
+			int length = -1;
+			if (rx->overrun)
+			{
+				rx->stats.overruns++;
+			}
+			else if (rx->encodedLength != 0)
+			{
+				length = frameAccept(rx, channel, buffer, size);
+			}
+			rx->encodedLength = 0;
+			rx->overrun = false;
+
+			if (length >= 0)
+			{
+				return length;
+			}
+		}
+	}
+}
+
+//Copy the receive statistics of a port into stats
+void UARTFrameGetStats(uint32_t portNum, uartFrameStats* stats)
+{
+	if (portNum < UART_NUM_PORTS)
+	{
+		*stats = uartFrameRxStates[portNum].stats;
+	}
+}
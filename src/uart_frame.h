@@ -0,0 +1,83 @@
+/*----------------------------------------------------------------------------
+ * Name: uart_frame.h
+ * Purpose: COBS framed packets with CRC-16 and per-channel sequence numbers over the UART ports
+ *----------------------------------------------------------------------------
+*/
+
+//Include guards for uart_frame
+#ifndef _uart_frame
+#define _uart_frame
+
+#include "osDefs.h"
+#include "uart.h"
+
+//Frame layout before encoding: channel, sequence number, payload, CRC-16 (low byte first) over everything before it
+//The frame is COBS encoded so it contains no zero bytes, and a zero byte ends it
+//A receiver that loses bytes resynchronises at the next zero
+#define FRAME_HEADER_SIZE 2
+#define FRAME_CRC_SIZE 2
+
+//Define the number of channels, each has its own sequence numbers
+#define FRAME_MAX_CHANNELS 8
+
+//Define the largest payload a frame can carry
+#define FRAME_MAX_PAYLOAD 256
+
+//Largest encoded frame without the delimiter, COBS adds one byte per 254 bytes plus one
+#define FRAME_MAX_ENCODED (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE + (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE) / 254 + 1)
+
+//Define the size of the chunk read from the UART receive ring at a time
+#define FRAME_RAW_SIZE 64
+
+//Longest run of non-zero bytes one COBS code byte can describe
+#define COBS_MAX_RUN 254
+
+//Define the receive statistics of one port
+typedef struct uart_frame_stats_struct
+{
+	uint32_t received; //Frames delivered to the caller
+	uint32_t crcErrors; //Frames dropped because the CRC or the COBS encoding was wrong
+	uint32_t overruns; //Frames dropped because they were longer than FRAME_MAX_ENCODED
+	uint32_t lost; //Frames missing according to the sequence numbers
+}uartFrameStats;
+
+//Define the receive state of one port
+typedef struct uart_frame_rx_struct
+{
+	uint8_t raw[FRAME_RAW_SIZE]; //Bytes read from the UART that have not been looked at yet
+	uint32_t rawStart; //Next byte to look at in raw
+	uint32_t rawEnd; //Number of bytes in raw
+	uint8_t encoded[FRAME_MAX_ENCODED]; //Encoded bytes of the frame being received, decoded in place once it ends
+	uint32_t encodedLength; //Number of bytes in encoded
+	bool overrun; //Whether the frame being received is too long and will be dropped
+	uint8_t nextSequence[FRAME_MAX_CHANNELS]; //Sequence number expected next on each channel
+	bool synced[FRAME_MAX_CHANNELS]; //Whether a frame has been received on each channel yet
+	uartFrameStats stats; //Receive statistics
+}uartFrameRx;
+
+//Define a read position in the list of pieces a frame is sent from
+typedef struct uart_frame_cursor_struct
+{
+	const uint8_t* data[3]; //Header, payload, and CRC, sent from where they are without copying them into a frame buffer
+	uint32_t length[3]; //Length of each piece
+	int piece; //Piece being read
+	uint32_t position; //Offset in the piece being read
+}uartFrameCursor;
+
+//Returns the CRC-16/CCITT-FALSE of a buffer continuing from crc (start with 0xFFFF)
+uint16_t frameCRC16(uint16_t crc, const uint8_t* data, uint32_t length);
+
+//Send a payload as one frame on a channel of a UART port that UARTInit has set up
+//The payload is encoded straight from the caller's buffer into the UART transmit ring without a staging copy
+//Frames from different threads are never interleaved, returns false for an invalid port, channel, or length
+bool UARTFrameSend(uint32_t portNum, uint8_t channel, const uint8_t* payload, uint32_t length);
+
+//Receive the next valid frame on a UART port, waiting up to timeout ticks (or WAIT_FOREVER)
+//The payload is copied to buffer and its channel to channel, returns the payload length or -1 on timeout
+//Frames with a bad CRC, that are too long, or that do not fit in buffer are dropped and counted
+int UARTFrameRecieve(uint32_t portNum, uint8_t* channel, uint8_t* buffer, uint32_t size, int timeout);
+
+//Copy the receive statistics of a port into stats
+void UARTFrameGetStats(uint32_t portNum, uartFrameStats* stats);
+
+#endif
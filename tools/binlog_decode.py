@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Decode the binary log stream written by the osBinLog macros.
+
+Each record is a sequence of little-endian 32-bit words:
+    header     format string address | number of arguments (low 3 bits)
+    timestamp  cycle count (portCycles) when the record was written
+    args       0 to 4 raw argument words
+
+The format strings are read back out of the .binlog_fmt section of the ELF
+file the firmware was built from. A header whose address is not an 8-aligned
+address in that section means bytes were lost on the wire, the decoder then
+slides forward one byte at a time until it finds a record again. Addresses in
+other sections are never accepted, so a run of zeros or a stray word cannot
+decode .text or .rodata as a format string.
+
+Usage: binlog_decode.py firmware.axf capture.bin [--clock HZ]
+       (use - as the capture to read from stdin)
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elf32 import Elf32
+
+ARG_MASK = 0x7
+FORMAT_SECTION = ".binlog_fmt"
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|z|j|t)?([diouxXcsp%])")
+
+
+def render(fmt, args):
+    """Apply a C format string to raw 32-bit argument words."""
+    args = list(args)
+
+    def substitute(match):
+        flags, _length, conv = match.groups()
+        if conv == "%":
+            return "%"
+        value = args.pop(0) if args else 0
+        if conv in "di":
+            value = value - (1 << 32) if value & 0x80000000 else value
+            conv = "d"
+        elif conv == "u":
+            conv = "d"
+        elif conv in "sp":
+            # Only the pointer was logged
+            return "0x%08x" % value
+        elif conv == "c":
+            value = chr(value & 0xFF)
+        return ("%" + flags + conv) % value
+
+    return CONVERSION.sub(substitute, fmt)
+
+
+def decode(elf, stream, clock):
+    formats = {}
+    offset = 0
+    last_cycles = None
+    elapsed = 0
+    while offset + 8 <= len(stream):
+        header, cycles = struct.unpack_from("<II", stream, offset)
+        address, count = header & ~ARG_MASK, header & ARG_MASK
+        fmt = formats.get(address)
+        if fmt is None and count <= 4 and address % 8 == 0:
+            fmt = elf.read_string(address, FORMAT_SECTION)
+            if fmt is not None:
+                formats[address] = fmt
+        if fmt is None or count > 4 or offset + 8 + 4 * count > len(stream):
+            offset += 1  # lost sync, try the next byte
+            continue
+
+        args = struct.unpack_from("<%dI" % count, stream, offset + 8)
+        offset += 8 + 4 * count
+
+        # The cycle counter wraps every 2^32 cycles, records are assumed to be closer together than that
+        if last_cycles is not None:
+            elapsed += (cycles - last_cycles) & 0xFFFFFFFF
+        last_cycles = cycles
+
+        text = render(fmt, args).rstrip("\r\n")
+        yield "%12.6f  %s" % (elapsed / clock, text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware image the log was produced by")
+    parser.add_argument("capture", help="raw bytes captured from the UART, - for stdin")
+    parser.add_argument("--clock", type=float, default=100e6, help="CPU clock in Hz (default 100 MHz)")
+    options = parser.parse_args()
+
+    elf = Elf32(options.elf)
+    if elf.section(FORMAT_SECTION) is None:
+        sys.exit("%s has no %s section, no osBinLog calls were built into it" % (options.elf, FORMAT_SECTION))
+    if options.capture == "-":
+        stream = sys.stdin.buffer.read()
+    else:
+        with open(options.capture, "rb") as f:
+            stream = f.read()
+
+    for line in decode(elf, stream, options.clock):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,71 @@
+"""Minimal ELF32 little-endian reader shared by the host tools.
+
+Only what the tools need: allocated sections (to read constants by address)
+and the symbol table (to turn addresses into function names).
+"""
+
+import struct
+
+SHT_PROGBITS = 1
+SHT_SYMTAB = 2
+SHF_ALLOC = 0x2
+STT_FUNC = 2
+
+
+class Elf32:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s is not a little-endian ELF32 file" % path)
+
+        (shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            fields = struct.unpack_from("<IIIIIIIIII", self.data, shoff + i * shentsize)
+            self.sections.append(dict(zip(
+                ("name", "type", "flags", "addr", "offset", "size", "link", "info", "align", "entsize"),
+                fields)))
+        names = self.sections[shstrndx]
+        for sec in self.sections:
+            sec["name"] = self._cstring(names["offset"] + sec["name"])
+
+    def _cstring(self, offset):
+        end = self.data.index(b"\0", offset)
+        return self.data[offset:end].decode("latin-1")
+
+    def section(self, name):
+        for sec in self.sections:
+            if sec["name"] == name:
+                return sec
+        return None
+
+    def read_string(self, address, section=None):
+        """Return the NUL-terminated string stored at a target address, or None.
+
+        With a section name only addresses inside that section are accepted.
+        """
+        for sec in self.sections:
+            if section is not None and sec["name"] != section:
+                continue
+            if sec["type"] == SHT_PROGBITS and sec["flags"] & SHF_ALLOC \
+                    and sec["addr"] <= address < sec["addr"] + sec["size"]:
+                return self._cstring(sec["offset"] + address - sec["addr"])
+        return None
+
+    def functions(self):
+        """Return (address, size, name) for every function symbol, sorted by address."""
+        result = []
+        for sec in self.sections:
+            if sec["type"] != SHT_SYMTAB:
+                continue
+            strtab = self.sections[sec["link"]]
+            for i in range(sec["size"] // 16):
+                name, value, size, info, _other, _shndx = struct.unpack_from(
+                    "<IIIBBH", self.data, sec["offset"] + i * 16)
+                if info & 0xF == STT_FUNC:
+                    # Thumb function symbols have bit 0 set
+                    result.append((value & ~1, size, self._cstring(strtab["offset"] + name)))
+        result.sort()
+        return result
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Decode the COBS framed packets sent by UARTFrameSend.
+
+Each frame is COBS encoded and ends with a zero byte. Decoded, it holds:
+    channel    1 byte
+    sequence   1 byte, counts up per channel
+    payload    0 to 256 bytes
+    crc        CRC-16/CCITT-FALSE of the bytes above, low byte first
+
+By default every frame is printed as a line of hex. With --channel and --raw
+the payloads of one channel are written to stdout as a byte stream, which can
+be piped into binlog_decode.py if that channel carries the binary log.
+
+Usage: frame_decode.py capture.bin [--channel N] [--raw]
+       (use - as the capture to read from stdin)
+"""
+
+import argparse
+import sys
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Return the decoded bytes, or None if the encoding is broken."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Stats:
+    def __init__(self):
+        self.received = 0
+        self.bad = 0
+        self.lost = 0
+        self.next_sequence = {}
+
+
+def frames(stream, stats):
+    """Yield (channel, sequence, payload) for every valid frame."""
+    for chunk in stream.split(b"\0"):
+        if not chunk:
+            continue
+        frame = cobs_decode(chunk)
+        if frame is None or len(frame) < 4:
+            stats.bad += 1
+            continue
+        body, crc = frame[:-2], frame[-2] | (frame[-1] << 8)
+        if crc16(body) != crc:
+            stats.bad += 1
+            continue
+        channel, sequence, payload = body[0], body[1], body[2:]
+        expected = stats.next_sequence.get(channel)
+        if expected is not None:
+            stats.lost += (sequence - expected) & 0xFF
+        stats.next_sequence[channel] = (sequence + 1) & 0xFF
+        stats.received += 1
+        yield channel, sequence, payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="raw bytes captured from the UART, - for stdin")
+    parser.add_argument("--channel", type=int, help="only show frames on this channel")
+    parser.add_argument("--raw", action="store_true", help="write the payloads to stdout as raw bytes")
+    options = parser.parse_args()
+
+    if options.capture == "-":
+        stream = sys.stdin.buffer.read()
+    else:
+        with open(options.capture, "rb") as f:
+            stream = f.read()
+
+    stats = Stats()
+    for channel, sequence, payload in frames(stream, stats):
+        if options.channel is not None and channel != options.channel:
+            continue
+        if options.raw:
+            sys.stdout.buffer.write(payload)
+        else:
+            print("ch %d seq %3d len %3d  %s" % (channel, sequence, len(payload), payload.hex()))
+
+    print("%d frames, %d bad, %d lost" % (stats.received, stats.bad, stats.lost), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
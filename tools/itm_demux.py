@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Split an SWO/ITM capture back into one stream per stimulus port.
+
+The firmware (src/itm.c) writes to these ports:
+    0       output from before the kernel starts
+    1..14   thread n on port n + 1
+    15      threads 14 and up, their characters interleave
+    16..30  subsystems
+    31      interrupt handlers
+
+The capture is the raw ITM packet stream, as saved by the debugger's SWO
+trace or a UART-mode SWO probe. Hardware (DWT) packets, timestamps,
+overflow and sync packets are skipped.
+
+By default every port is written to <prefix><port>.txt and the text is also
+printed line by line with the port in front. With --port the bytes of one
+port are written to stdout unchanged.
+
+Usage: itm_demux.py capture.swo [--port N] [--prefix itm_port]
+       (use - as the capture to read from stdin)
+"""
+
+import argparse
+import sys
+
+PAYLOAD_SIZE = {1: 1, 2: 2, 3: 4}
+
+
+def packets(stream):
+    """Yield (port, payload bytes) for every software source packet."""
+    i = 0
+    while i < len(stream):
+        header = stream[i]
+        i += 1
+
+        if header == 0x00:
+            # Synchronisation: a run of zeros ended by 0x80
+            while i < len(stream) and stream[i] == 0x00:
+                i += 1
+            if i < len(stream) and stream[i] == 0x80:
+                i += 1
+            continue
+        if header == 0x70:
+            continue  # overflow, some packets were lost
+
+        if header & 0x03 == 0:
+            # Timestamp and extension packets, followed by continuation bytes while bit 7 is set
+            if header & 0x80:
+                while i < len(stream) and stream[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+
+        size = PAYLOAD_SIZE[header & 0x03]
+        payload = stream[i:i + size]
+        i += size
+        if header & 0x04:
+            continue  # hardware source packet from the DWT
+        yield header >> 3, payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="raw ITM packet stream, - for stdin")
+    parser.add_argument("--port", type=int, help="write the bytes of this port to stdout")
+    parser.add_argument("--prefix", default="itm_port", help="prefix of the per-port output files")
+    options = parser.parse_args()
+
+    if options.capture == "-":
+        stream = sys.stdin.buffer.read()
+    else:
+        with open(options.capture, "rb") as f:
+            stream = f.read()
+
+    streams = {}
+    for port, payload in packets(stream):
+        streams.setdefault(port, bytearray()).extend(payload)
+
+    if options.port is not None:
+        sys.stdout.buffer.write(streams.get(options.port, b""))
+        return
+
+    for port in sorted(streams):
+        with open("%s%d.txt" % (options.prefix, port), "wb") as f:
+            f.write(streams[port])
+        name = "main" if port == 0 else "isr" if port == 31 else \
+            "thread %d" % (port - 1) if port < 15 else "threads 14+" if port == 15 else "port %d" % port
+        for line in streams[port].decode("latin-1").splitlines():
+            print("[%s] %s" % (name, line))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Turn a PC-sampling profile dump into flat and per-thread function profiles.
+
+The firmware samples the interrupted PC with TIMER3 when it is built with
+OS_PROFILE and osProfileStart is called. Dump osProfileBuf either from the
+debugger (SAVE profile.hex &osProfileBuf, &osProfileBuf + sizeof(osProfileBuf)
+in uVision, which writes Intel HEX) or over a UART with osProfileDump (raw
+bytes). The buffer starts with a small header:
+    magic       'PROF'
+    clock       CPU clock in Hz
+    rate        sampling rate in Hz
+    samples     number of samples taken
+    dropped     samples that found no free slot in the table
+    capacity    number of slots
+    maxThreads  number of entries in threadFuncs
+    threadFuncs function address of each thread (0 for unused entries)
+followed by capacity 12-byte slots {pc, thread, count}.
+
+Samples are symbolised against the ELF the firmware was built from. The flat
+profile counts every sample, the per-thread profiles split them by the thread
+that was running, and samples taken inside interrupt handlers get their own
+section.
+
+Usage: profile_report.py firmware.axf dump.bin|dump.hex [--top N] [--lines]
+"""
+
+import argparse
+import bisect
+import struct
+import sys
+from collections import Counter, defaultdict
+
+from elf32 import Elf32
+from trace_to_chrome import read_intel_hex, thread_names
+
+MAGIC = 0x464F5250
+HEADER = "<7I"
+
+THREAD_ISR = 0xFF
+THREAD_MAIN = 0xFE
+
+
+def load_dump(path):
+    if path == "-":
+        raw = sys.stdin.buffer.read()
+    else:
+        with open(path, "rb") as f:
+            raw = f.read()
+    if raw.lstrip().startswith(b":"):
+        raw = read_intel_hex(raw.decode("ascii", "replace"))
+
+    # A UART capture may have bytes in front of the dump
+    offset = raw.find(struct.pack("<I", MAGIC))
+    if offset < 0:
+        sys.exit("no profile buffer found (magic 'PROF' missing)")
+    return raw[offset:]
+
+
+def parse(dump):
+    """Return (header dict, thread function addresses, [(pc, thread, count)])."""
+    fields = struct.unpack_from(HEADER, dump)
+    header = dict(zip(("magic", "clock", "rate", "samples", "dropped", "capacity", "max_threads"), fields))
+    funcs = list(struct.unpack_from("<%dI" % header["max_threads"], dump, 28))
+    base = 28 + 4 * header["max_threads"]
+    if len(dump) < base + 12 * header["capacity"]:
+        sys.exit("dump is truncated, expected %d bytes" % (base + 12 * header["capacity"]))
+
+    slots = []
+    for i in range(header["capacity"]):
+        pc, thread, count = struct.unpack_from("<3I", dump, base + 12 * i)
+        if count:
+            slots.append((pc, thread, count))
+    return header, funcs, slots
+
+
+class Symbolizer:
+    def __init__(self, elf_path):
+        self.functions = Elf32(elf_path).functions()
+        self.starts = [address for address, _size, _name in self.functions]
+
+    def lookup(self, pc):
+        """Return the function holding pc and the offset into it, or the bare address and None."""
+        i = bisect.bisect_right(self.starts, pc) - 1
+        if i >= 0:
+            address, size, name = self.functions[i]
+            # Symbols without a size (hand written assembly) are taken to run up to the next one
+            if pc < address + size or size == 0:
+                return name, pc - address
+        return "0x%08x" % pc, None
+
+
+def print_table(title, counter, total, top):
+    print("%s (%d samples)" % (title, total))
+    print("  %8s %7s  %s" % ("samples", "share", "location"))
+    for name, count in counter.most_common(top):
+        print("  %8d %6.2f%%  %s" % (count, 100.0 * count / total, name))
+    if top and len(counter) > top:
+        rest = sum(count for _name, count in counter.most_common()[top:])
+        print("  %8d %6.2f%%  (%d more)" % (rest, 100.0 * rest / total, len(counter) - top))
+    print()
+
+
+def report(header, funcs, slots, symbolizer, elf_path, top, lines):
+    names = thread_names(funcs, elf_path)
+    names[THREAD_ISR] = "interrupts"
+    names[THREAD_MAIN] = "main (before kernel_start)"
+
+    flat = Counter()
+    per_thread = defaultdict(Counter)
+    for pc, thread, count in slots:
+        name, offset = symbolizer.lookup(pc)
+        location = "%s+0x%x" % (name, offset) if lines and offset is not None else name
+        flat[location] += count
+        per_thread[thread][location] += count
+
+    samples = sum(count for _pc, _thread, count in slots)
+    seconds = header["samples"] / header["rate"] if header["rate"] else 0
+    print("# %d samples at %d Hz (%.1f s), %d dropped, clock %d Hz"
+          % (header["samples"], header["rate"], seconds, header["dropped"], header["clock"]))
+    if header["dropped"]:
+        print("# the table filled up, raise PROFILE_SLOTS for a complete profile")
+    print()
+
+    if not samples:
+        return
+    print_table("flat profile", flat, samples, top)
+    for thread in sorted(per_thread):
+        counter = per_thread[thread]
+        total = sum(counter.values())
+        title = "%s, %.1f%% of all samples" % (names.get(thread, "thread %d" % thread), 100.0 * total / samples)
+        print_table(title, counter, total, top)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf", help="firmware image the profile was taken on")
+    parser.add_argument("dump", help="raw or Intel HEX dump of osProfileBuf, - for stdin")
+    parser.add_argument("--top", type=int, default=20, help="rows per table, 0 for all (default 20)")
+    parser.add_argument("--lines", action="store_true", help="count function+offset instead of whole functions")
+    options = parser.parse_args()
+
+    header, funcs, slots = parse(load_dump(options.dump))
+    report(header, funcs, slots, Symbolizer(options.elf), options.elf, options.top or None, options.lines)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Convert a scheduler trace dump into Chrome trace event JSON.
+
+The firmware records into osTraceBuf when it is built with OS_TRACE. Dump the
+buffer either from the debugger (for example SAVE trace.hex &osTraceBuf,
+&osTraceBuf + sizeof(osTraceBuf) in uVision, which writes Intel HEX) or over a
+UART with osTraceDump (raw bytes). The buffer starts with a small header:
+    magic       'TRCE'
+    head        number of events recorded, the ring wraps at capacity
+    clock       CPU clock in Hz
+    capacity    number of events in the ring
+    maxThreads  number of entries in threadFuncs
+    threadFuncs function address of each thread (0 for unused entries)
+followed by capacity 8-byte events {cycles, type, thread, a, b}.
+
+Open the output in chrome://tracing or https://ui.perfetto.dev. Each thread
+gets a row of running slices labelled with why it gave up the CPU, interrupt
+handlers get their own row, wakeups and mutex operations are instant events.
+
+Usage: trace_to_chrome.py dump.bin|dump.hex [--elf firmware.axf] [-o trace.json]
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x45435254
+HEADER = "<5I"
+
+TRACE_SWITCH = 1
+TRACE_WAKE = 2
+TRACE_MUTEX_ACQUIRE = 3
+TRACE_MUTEX_RELEASE = 4
+TRACE_ISR_ENTER = 5
+TRACE_ISR_EXIT = 6
+
+NONE = 0xFF  # thread or argument recorded from -1
+ISR_TID = 1000  # row used for interrupt handlers
+
+REASONS = {0: "yield", 1: "timeslice", 2: "sleep", 3: "block"}
+WAKE_CAUSES = {0: "signal", 1: "sleep done", 2: "timeout", 3: "mutex handoff"}
+EXCEPTIONS = {11: "SVCall", 14: "PendSV", 15: "SysTick", 17: "TIMER0", 18: "TIMER1",
+              21: "UART0", 22: "UART1", 23: "UART2", 24: "UART3", 42: "DMA"}
+
+
+def read_intel_hex(text):
+    """Return the bytes of an Intel HEX file, starting at its lowest address."""
+    memory = {}
+    base = 0
+    for line in text.splitlines():
+        line = line.strip()
+        if not line.startswith(":"):
+            continue
+        record = bytes.fromhex(line[1:])
+        count, address, kind = record[0], (record[1] << 8) | record[2], record[3]
+        data = record[4:4 + count]
+        if kind == 0:
+            for i, byte in enumerate(data):
+                memory[base + address + i] = byte
+        elif kind == 2:
+            base = int.from_bytes(data, "big") << 4
+        elif kind == 4:
+            base = int.from_bytes(data, "big") << 16
+        elif kind == 1:
+            break
+    if not memory:
+        return b""
+    start = min(memory)
+    return bytes(memory.get(a, 0) for a in range(start, max(memory) + 1))
+
+
+def load_dump(path):
+    if path == "-":
+        raw = sys.stdin.buffer.read()
+    else:
+        with open(path, "rb") as f:
+            raw = f.read()
+    if raw.lstrip().startswith(b":"):
+        raw = read_intel_hex(raw.decode("ascii", "replace"))
+
+    # A UART capture may have bytes in front of the dump
+    offset = raw.find(struct.pack("<I", MAGIC))
+    if offset < 0:
+        sys.exit("no trace buffer found (magic 'TRCE' missing)")
+    return raw[offset:]
+
+
+def parse(dump):
+    """Return (clock, thread function addresses, events oldest first)."""
+    _magic, head, clock, capacity, max_threads = struct.unpack_from(HEADER, dump)
+    funcs = list(struct.unpack_from("<%dI" % max_threads, dump, 20))
+    base = 20 + 4 * max_threads
+    if len(dump) < base + 8 * capacity:
+        sys.exit("dump is truncated, expected %d bytes" % (base + 8 * capacity))
+
+    if head <= capacity:
+        order = range(head)
+    else:
+        order = [(head + i) % capacity for i in range(capacity)]  # oldest entry is the next to be overwritten
+    events = [struct.unpack_from("<IBBBB", dump, base + 8 * i) for i in order]
+    return clock, funcs, events
+
+
+def thread_names(funcs, elf_path):
+    names = {}
+    symbols = []
+    if elf_path:
+        from elf32 import Elf32
+        symbols = Elf32(elf_path).functions()
+    used = [i for i, f in enumerate(funcs) if f]
+    for i in used:
+        address = funcs[i] & ~1
+        name = next((n for a, _s, n in symbols if a == address), None)
+        if name is None:
+            name = "idle" if i == used[-1] else "thread %d" % i  # kernel_start creates the idle thread last
+        names[i] = "%d: %s" % (i, name)
+    return names
+
+
+def convert(clock, funcs, events, elf_path=None):
+    out = []
+    names = thread_names(funcs, elf_path)
+    for tid, name in names.items():
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": tid, "args": {"name": name}})
+        out.append({"ph": "M", "name": "thread_sort_index", "pid": 0, "tid": tid, "args": {"sort_index": tid}})
+    out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": ISR_TID, "args": {"name": "interrupts"}})
+
+    def us(cycles):
+        return cycles * 1e6 / clock
+
+    elapsed = 0
+    last = None
+    running = None  # (thread, start time)
+    isr_depth = 0
+    for cycles, kind, thread, a, b in events:
+        # The cycle counter wraps every 2^32 cycles, events are assumed to be closer together than that
+        if last is not None:
+            elapsed += (cycles - last) & 0xFFFFFFFF
+        last = cycles
+        ts = us(elapsed)
+
+        if kind == TRACE_SWITCH:
+            # A wrapped ring starts part way through a slice, it starts at the first event seen
+            start = running[1] if running and running[0] == thread else 0.0
+            if thread != NONE:
+                out.append({"ph": "X", "name": "running", "pid": 0, "tid": thread, "ts": start,
+                            "dur": ts - start, "args": {"switched out": REASONS.get(b, b), "next": a}})
+            running = (a, ts)
+        elif kind == TRACE_WAKE:
+            out.append({"ph": "i", "s": "t", "name": "wake (%s)" % WAKE_CAUSES.get(a, a),
+                        "pid": 0, "tid": thread, "ts": ts})
+        elif kind == TRACE_MUTEX_ACQUIRE:
+            out.append({"ph": "i", "s": "t", "name": ("acquire mutex %d" if b else "blocked on mutex %d") % a,
+                        "pid": 0, "tid": thread, "ts": ts})
+        elif kind == TRACE_MUTEX_RELEASE:
+            args = {"handed to": b} if b != NONE else {}
+            out.append({"ph": "i", "s": "t", "name": "release mutex %d" % a,
+                        "pid": 0, "tid": thread, "ts": ts, "args": args})
+        elif kind == TRACE_ISR_ENTER:
+            isr_depth += 1
+            out.append({"ph": "B", "name": EXCEPTIONS.get(a, "IRQ %d" % (a - 16)),
+                        "pid": 0, "tid": ISR_TID, "ts": ts})
+        elif kind == TRACE_ISR_EXIT and isr_depth > 0:  # an exit without its entry was cut off by the ring
+            isr_depth -= 1
+            out.append({"ph": "E", "pid": 0, "tid": ISR_TID, "ts": ts})
+
+    # Close the slice of the thread that was running when the dump was taken
+    if running and running[0] != NONE:
+        out.append({"ph": "X", "name": "running", "pid": 0, "tid": running[0], "ts": running[1],
+                    "dur": us(elapsed) - running[1], "args": {"switched out": "end of trace"}})
+    return {"traceEvents": out, "displayTimeUnit": "ns", "otherData": {"clock": clock, "events": len(events)}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="raw or Intel HEX dump of osTraceBuf, - for stdin")
+    parser.add_argument("--elf", help="firmware image, names threads after their functions")
+    parser.add_argument("-o", "--output", help="JSON file to write (default stdout)")
+    options = parser.parse_args()
+
+    clock, funcs, events = parse(load_dump(options.dump))
+    trace = convert(clock, funcs, events, options.elf)
+    if options.output:
+        with open(options.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()